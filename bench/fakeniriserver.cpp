@@ -0,0 +1,148 @@
+#include "fakeniriserver.h"
+#include <QCoreApplication>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QDebug>
+
+FakeNiriServer::FakeNiriServer(QObject *parent)
+    : QObject(parent)
+    , m_server(new QLocalServer(this))
+    , m_replayTimer(new QTimer(this))
+    , m_windows(QJsonArray())
+    , m_workspaces(QJsonArray())
+{
+    m_replayTimer->setSingleShot(true);
+    m_replayTimer->setTimerType(Qt::PreciseTimer);
+
+    QObject::connect(m_server, &QLocalServer::newConnection,
+                     this, &FakeNiriServer::onNewConnection);
+    QObject::connect(m_replayTimer, &QTimer::timeout,
+                     this, &FakeNiriServer::replayNext);
+}
+
+bool FakeNiriServer::listen(const QString &name)
+{
+    static int serverCount = 0;
+    if (name.isEmpty()) {
+        return listen(QString("fake-niri-%1-%2")
+                          .arg(QCoreApplication::applicationPid())
+                          .arg(serverCount++));
+    }
+
+    QLocalServer::removeServer(name);
+    if (!m_server->listen(name)) {
+        qWarning() << "Failed to listen on" << name << ":" << m_server->errorString();
+        return false;
+    }
+    return true;
+}
+
+void FakeNiriServer::onNewConnection()
+{
+    while (QLocalSocket *socket = m_server->nextPendingConnection()) {
+        m_framers.insert(socket, LineFramer());
+
+        QObject::connect(socket, &QLocalSocket::readyRead, this, [this, socket] {
+            m_framers[socket].append(socket->readAll(), [this, socket](const QByteArray &line) {
+                handleRequest(socket, line);
+            });
+        });
+        QObject::connect(socket, &QLocalSocket::disconnected, this, [this, socket] {
+            m_framers.remove(socket);
+            socket->deleteLater();
+        });
+    }
+}
+
+void FakeNiriServer::handleRequest(QLocalSocket *socket, const QByteArray &line)
+{
+    // Wrap the line so unit requests such as "Outputs" parse as well
+    const QJsonArray wrapped = QJsonDocument::fromJson("[" + line + "]").array();
+    QJsonValue request = wrapped.isEmpty() ? QJsonValue() : wrapped.first();
+    QJsonObject reply;
+
+    if (request.toString() == "EventStream") {
+        reply = {{"Ok", "Handled"}};
+    } else if (request.toString() == "Windows") {
+        reply = {{"Ok", QJsonObject{{"Windows", m_windows}}}};
+    } else if (request.toString() == "Workspaces") {
+        reply = {{"Ok", QJsonObject{{"Workspaces", m_workspaces}}}};
+    } else if (request.toString() == "Outputs") {
+        reply = {{"Ok", QJsonObject{{"Outputs", QJsonObject()}}}};
+    } else if (request.toObject().contains("Action")) {
+        ++m_actionCount;
+        reply = {{"Ok", "Handled"}};
+    } else {
+        reply = {{"Err", "Unsupported request: " + QString::fromUtf8(line)}};
+    }
+
+    socket->write(QJsonDocument(reply).toJson(QJsonDocument::Compact) + "\n");
+
+    if (request.toString() == "EventStream" && !m_eventSocket) {
+        startReplay(socket);
+    }
+}
+
+void FakeNiriServer::startReplay(QLocalSocket *socket)
+{
+    m_eventSocket = socket;
+    m_position = 0;
+    m_sendTimes.clear();
+    m_sendTimes.reserve(m_trace.size());
+    m_replayStartNs = monotonicNanoseconds();
+
+    replayNext();
+}
+
+void FakeNiriServer::replayNext()
+{
+    if (!m_eventSocket) {
+        return;
+    }
+
+    if (m_mode == ReplayMode::FullSpeed) {
+        while (m_position < m_trace.size()) {
+            sendLine(m_position++);
+        }
+    } else {
+        const qint64 firstUs = m_trace.isEmpty() ? 0 : m_trace.first().timestampUs;
+        while (m_position < m_trace.size()) {
+            qint64 dueNs = m_replayStartNs + (m_trace[m_position].timestampUs - firstUs) * 1000;
+            qint64 waitNs = dueNs - monotonicNanoseconds();
+            if (waitNs > 0) {
+                m_replayTimer->start(int((waitNs + 999999) / 1000000));
+                return;
+            }
+            sendLine(m_position++);
+        }
+    }
+
+    m_eventSocket->flush();
+    emit replayFinished();
+}
+
+void FakeNiriServer::sendLine(int position)
+{
+    const QByteArray &line = m_trace[position].line;
+    trackSnapshot(line);
+
+    m_sendTimes.append(monotonicNanoseconds());
+    m_eventSocket->write(line);
+    m_eventSocket->write("\n");
+    if (m_mode == ReplayMode::RealTime) {
+        m_eventSocket->flush();
+    }
+}
+
+void FakeNiriServer::trackSnapshot(const QByteArray &line)
+{
+    // Only parse the lines that carry a snapshot
+    if (line.startsWith("{\"WindowsChanged\"")) {
+        const QJsonObject event = QJsonDocument::fromJson(line).object();
+        m_windows = event.value("WindowsChanged").toObject().value("windows");
+    } else if (line.startsWith("{\"WorkspacesChanged\"")) {
+        const QJsonObject event = QJsonDocument::fromJson(line).object();
+        m_workspaces = event.value("WorkspacesChanged").toObject().value("workspaces");
+    }
+}
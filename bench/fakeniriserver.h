@@ -0,0 +1,74 @@
+#pragma once
+
+#include <QHash>
+#include <QJsonValue>
+#include <QList>
+#include <QLocalServer>
+#include <QLocalSocket>
+#include <QObject>
+#include <QPointer>
+#include <QTimer>
+#include "lineframer.h"
+#include "trace.h"
+
+/**
+ * Stand-in for the niri IPC socket.
+ *
+ * Answers Action requests with {"Ok":"Handled"}, answers snapshot requests
+ * (Windows, Workspaces, Outputs) from the last snapshots replayed, and
+ * replays a trace to the client that requests the EventStream. Once that
+ * client disconnects, the next one gets the trace replayed again.
+ */
+class FakeNiriServer : public QObject
+{
+    Q_OBJECT
+
+public:
+    enum class ReplayMode {
+        // Write all lines back to back
+        FullSpeed,
+        // Honour the trace timestamps
+        RealTime
+    };
+
+    explicit FakeNiriServer(QObject *parent = nullptr);
+
+    // Listen on name, or a unique name if empty; call in the server's thread
+    bool listen(const QString &name = QString());
+    QString socketPath() const { return m_server->fullServerName(); }
+
+    void setTrace(const Trace &trace) { m_trace = trace; }
+    void setReplayMode(ReplayMode mode) { m_mode = mode; }
+
+    // Send time of each trace line, see monotonicNanoseconds()
+    const QList<qint64> &sendTimes() const { return m_sendTimes; }
+    int actionCount() const { return m_actionCount; }
+
+signals:
+    void replayFinished();
+
+private slots:
+    void onNewConnection();
+    void replayNext();
+
+private:
+    void handleRequest(QLocalSocket *socket, const QByteArray &line);
+    void startReplay(QLocalSocket *socket);
+    void sendLine(int position);
+    void trackSnapshot(const QByteArray &line);
+
+    QLocalServer *m_server = nullptr;
+    QHash<QLocalSocket*, LineFramer> m_framers;
+
+    Trace m_trace;
+    ReplayMode m_mode = ReplayMode::FullSpeed;
+    QPointer<QLocalSocket> m_eventSocket;
+    QTimer *m_replayTimer = nullptr;
+    int m_position = 0;
+    qint64 m_replayStartNs = 0;
+    QList<qint64> m_sendTimes;
+
+    QJsonValue m_windows;
+    QJsonValue m_workspaces;
+    int m_actionCount = 0;
+};
@@ -0,0 +1,50 @@
+#include <chrono>
+#include <cstdio>
+#include <QByteArray>
+#include "lineframer.h"
+
+// Frames batches of event lines delivered in a single append(), the case in
+// which shifting the buffer once per line made framing quadratic. The cost
+// per line should stay flat as the batch grows.
+
+static qint64 nowNs()
+{
+    using namespace std::chrono;
+    return duration_cast<nanoseconds>(steady_clock::now().time_since_epoch()).count();
+}
+
+static QByteArray makeBatch(int lineCount)
+{
+    QByteArray data;
+    for (int i = 0; i < lineCount; ++i) {
+        data += "{\"WindowOpenedOrChanged\":{\"window\":{\"id\":" + QByteArray::number(i)
+            + ",\"title\":\"Window " + QByteArray::number(i)
+            + "\",\"app_id\":\"org.example.App\",\"pid\":1234,\"workspace_id\":1,"
+              "\"is_focused\":false,\"is_floating\":false,\"is_urgent\":false}}}\n";
+    }
+    return data;
+}
+
+int main()
+{
+    // Enough lines per size for stable timings
+    constexpr qint64 TargetLines = 1000000;
+
+    std::printf("%10s %10s %12s %10s\n", "lines", "batches", "ns/line", "MB/s");
+    for (int lineCount : {1000, 10000, 100000}) {
+        const QByteArray batch = makeBatch(lineCount);
+        const int batches = int(TargetLines / lineCount);
+
+        qint64 lines = 0;
+        qint64 start = nowNs();
+        for (int i = 0; i < batches; ++i) {
+            LineFramer framer;
+            framer.append(batch, [&lines](const QByteArray &) { ++lines; });
+        }
+        double ns = double(nowNs() - start);
+
+        std::printf("%10d %10d %12.1f %10.0f\n", lineCount, batches, ns / lines,
+                    batch.size() * double(batches) / ns * 1e3);
+    }
+    return 0;
+}
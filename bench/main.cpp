@@ -0,0 +1,216 @@
+#include <algorithm>
+#include <atomic>
+#include <cstdio>
+#include <cstdlib>
+#include <new>
+#include <utility>
+#include <QCommandLineParser>
+#include <QCoreApplication>
+#include <QEventLoop>
+#include <QLoggingCategory>
+#include <QThread>
+#include <QTimer>
+#include "fakeniriserver.h"
+#include "ipcclient.h"
+#include "trace.h"
+#include "windowmodel.h"
+#include "workspacemodel.h"
+
+// Allocations made on the thread that runs the models, while enabled. With
+// --threaded, allocations made while reading and parsing are not included.
+static std::atomic<quint64> s_allocations{0};
+static thread_local bool t_countAllocations = false;
+
+void *operator new(std::size_t size)
+{
+    if (t_countAllocations) {
+        s_allocations.fetch_add(1, std::memory_order_relaxed);
+    }
+    if (void *ptr = std::malloc(size ? size : 1)) {
+        return ptr;
+    }
+    throw std::bad_alloc();
+}
+
+void operator delete(void *ptr) noexcept
+{
+    std::free(ptr);
+}
+
+void operator delete(void *ptr, std::size_t) noexcept
+{
+    std::free(ptr);
+}
+
+struct ReplayResult {
+    int events = 0;
+    double seconds = 0;
+    QList<qint64> latenciesNs;
+    quint64 allocations = 0;
+    bool complete = false;
+};
+
+static ReplayResult replay(const Trace &trace, FakeNiriServer::ReplayMode mode, bool threaded)
+{
+    ReplayResult result;
+
+    QThread serverThread;
+    serverThread.setObjectName("fake-niri");
+    auto *server = new FakeNiriServer;
+    server->setTrace(trace);
+    server->setReplayMode(mode);
+    server->moveToThread(&serverThread);
+    serverThread.start();
+
+    bool listening = false;
+    QMetaObject::invokeMethod(server, [server, &listening] { listening = server->listen(); },
+                              Qt::BlockingQueuedConnection);
+    if (!listening) {
+        QMetaObject::invokeMethod(server, &QObject::deleteLater);
+        serverThread.quit();
+        serverThread.wait();
+        return result;
+    }
+    qputenv("NIRI_SOCKET", server->socketPath().toUtf8());
+
+    QList<qint64> receiveTimes;
+    receiveTimes.reserve(trace.size());
+
+    {
+        IPCClient client;
+        client.setAutoReconnect(false);
+        client.setThreaded(threaded);
+        WorkspaceModel workspaces;
+        WindowModel windows;
+
+        // Same wiring as Niri, plus a final handler that timestamps each event
+        QEventLoop loop;
+        for (NiriEvent::Type type : WorkspaceModel::handledEvents()) {
+            client.subscribe(type, [&workspaces](const NiriEvent &event) {
+                workspaces.handleEvent(event);
+            });
+        }
+        for (NiriEvent::Type type : WindowModel::handledEvents()) {
+            client.subscribe(type, [&windows](const NiriEvent &event) {
+                windows.handleEvent(event);
+            });
+        }
+        for (int type = 0; type < NiriEvent::TypeCount; ++type) {
+            client.subscribe(NiriEvent::Type(type), [&](const NiriEvent &) {
+                receiveTimes.append(monotonicNanoseconds());
+                if (receiveTimes.size() == trace.size()) {
+                    loop.quit();
+                }
+            });
+        }
+
+        QObject::connect(&client, &IPCClient::errorOccurred, &loop, &QEventLoop::quit);
+        QTimer::singleShot(120000, &loop, &QEventLoop::quit);
+
+        s_allocations = 0;
+        t_countAllocations = true;
+        if (client.connect() && !trace.isEmpty()) {
+            loop.exec();
+        }
+        t_countAllocations = false;
+        result.allocations = s_allocations;
+    }
+
+    QList<qint64> sendTimes;
+    QMetaObject::invokeMethod(server, [server, &sendTimes] {
+        sendTimes = server->sendTimes();
+        server->deleteLater();
+    }, Qt::BlockingQueuedConnection);
+    serverThread.quit();
+    serverThread.wait();
+
+    result.events = receiveTimes.size();
+    result.complete = result.events == trace.size() && sendTimes.size() == trace.size();
+
+    if (result.complete && result.events > 0) {
+        result.seconds = (receiveTimes.last() - sendTimes.first()) / 1e9;
+        for (int i = 0; i < result.events; ++i) {
+            result.latenciesNs.append(receiveTimes[i] - sendTimes[i]);
+        }
+        std::sort(result.latenciesNs.begin(), result.latenciesNs.end());
+    }
+
+    return result;
+}
+
+static double percentileUs(const QList<qint64> &sorted, double percentile)
+{
+    if (sorted.isEmpty()) {
+        return 0;
+    }
+    qsizetype index = qMin(sorted.size() - 1, qsizetype(percentile * sorted.size()));
+    return sorted[index] / 1000.0;
+}
+
+static void printResult(const QString &name, const ReplayResult &result)
+{
+    if (!result.complete) {
+        std::printf("%-24s incomplete: %d events received\n", qPrintable(name), result.events);
+        return;
+    }
+
+    std::printf("%-24s %8d %12.0f %9.1f %9.1f %9.1f %9.1f %10.1f\n",
+                qPrintable(name), result.events,
+                result.seconds > 0 ? result.events / result.seconds : 0.0,
+                percentileUs(result.latenciesNs, 0.5),
+                percentileUs(result.latenciesNs, 0.9),
+                percentileUs(result.latenciesNs, 0.99),
+                percentileUs(result.latenciesNs, 1.0),
+                double(result.allocations) / result.events);
+}
+
+int main(int argc, char *argv[])
+{
+    QCoreApplication app(argc, argv);
+    QCoreApplication::setApplicationName("niri-bench");
+
+    QCommandLineParser parser;
+    parser.setApplicationDescription("Replays niri event traces through IPCClient and the models");
+    parser.addHelpOption();
+    parser.addOption({"trace", "Replay a recorded trace instead of synthetic ones.", "file"});
+    parser.addOption({"windows", "Comma separated window counts of the synthetic traces.", "counts", "10,100,1000"});
+    parser.addOption({"events", "Number of events after the initial snapshots.", "count", "2000"});
+    parser.addOption({"realtime", "Honour trace timestamps instead of replaying at full speed."});
+    parser.addOption({"threaded", "Read the event stream on a worker thread."});
+    parser.process(app);
+
+    // Per-event debug output would dominate the measurements
+    QLoggingCategory::setFilterRules("*.debug=false");
+
+    const auto mode = parser.isSet("realtime") ? FakeNiriServer::ReplayMode::RealTime
+                                               : FakeNiriServer::ReplayMode::FullSpeed;
+    const bool threaded = parser.isSet("threaded");
+
+    QList<QPair<QString, Trace>> traces;
+    if (parser.isSet("trace")) {
+        QString error;
+        Trace trace = TraceFile::load(parser.value("trace"), &error);
+        if (trace.isEmpty()) {
+            std::fprintf(stderr, "Cannot load trace: %s\n", qPrintable(error));
+            return 1;
+        }
+        traces.append({parser.value("trace").section('/', -1), trace});
+    } else {
+        int events = parser.value("events").toInt();
+        const QStringList counts = parser.value("windows").split(',', Qt::SkipEmptyParts);
+        for (const QString &count : counts) {
+            traces.append({count + " windows", SyntheticTrace::generate(count.toInt(), events)});
+        }
+    }
+
+    // Warm up icon lookups and the allocator
+    replay(SyntheticTrace::generate(10, 100), FakeNiriServer::ReplayMode::FullSpeed, threaded);
+
+    std::printf("%-24s %8s %12s %9s %9s %9s %9s %10s\n",
+                "trace", "events", "events/s", "p50 us", "p90 us", "p99 us", "max us", "allocs/ev");
+    for (const auto &[name, trace] : std::as_const(traces)) {
+        printResult(name, replay(trace, mode, threaded));
+    }
+
+    return 0;
+}
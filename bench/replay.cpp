@@ -0,0 +1,52 @@
+#include <cstdio>
+#include <QCommandLineParser>
+#include <QCoreApplication>
+#include "fakeniriserver.h"
+#include "trace.h"
+
+// Serves a recorded trace as a stand-in niri socket, so a shell can be
+// pointed at it with NIRI_SOCKET to reproduce a session offline.
+int main(int argc, char *argv[])
+{
+    QCoreApplication app(argc, argv);
+    QCoreApplication::setApplicationName("niri-replay");
+
+    QCommandLineParser parser;
+    parser.setApplicationDescription("Replays a recorded niri event trace to clients");
+    parser.addHelpOption();
+    parser.addPositionalArgument("trace", "Trace recorded with Niri.startRecording().");
+    parser.addOption({"socket", "Socket name or path to listen on.", "path"});
+    parser.addOption({"fast", "Replay at full speed instead of with the recorded timing."});
+    parser.process(app);
+
+    if (parser.positionalArguments().size() != 1) {
+        parser.showHelp(1);
+    }
+
+    QString error;
+    Trace trace = TraceFile::load(parser.positionalArguments().first(), &error);
+    if (trace.isEmpty()) {
+        std::fprintf(stderr, "Cannot load trace: %s\n", qPrintable(error));
+        return 1;
+    }
+
+    FakeNiriServer server;
+    server.setTrace(trace);
+    server.setReplayMode(parser.isSet("fast") ? FakeNiriServer::ReplayMode::FullSpeed
+                                              : FakeNiriServer::ReplayMode::RealTime);
+
+    if (!server.listen(parser.value("socket"))) {
+        return 1;
+    }
+
+    QObject::connect(&server, &FakeNiriServer::replayFinished, [&trace] {
+        std::printf("Replayed %lld events\n", qint64(trace.size()));
+        std::fflush(stdout);
+    });
+
+    std::printf("Serving %lld events, run clients with:\nNIRI_SOCKET=%s\n",
+                qint64(trace.size()), qPrintable(server.socketPath()));
+    std::fflush(stdout);
+
+    return app.exec();
+}
@@ -0,0 +1,160 @@
+#include "trace.h"
+#include <chrono>
+#include <QFile>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QRandomGenerator>
+
+Trace TraceFile::load(const QString &path, QString *error)
+{
+    QFile file(path);
+    if (!file.open(QIODevice::ReadOnly)) {
+        if (error) {
+            *error = file.errorString();
+        }
+        return {};
+    }
+
+    Trace trace;
+    qint64 lastTimestamp = 0;
+
+    while (!file.atEnd()) {
+        QByteArray line = file.readLine();
+        if (line.endsWith('\n')) {
+            line.chop(1);
+        }
+        if (line.isEmpty()) {
+            continue;
+        }
+
+        TraceEntry entry;
+        qsizetype tab = line.indexOf('\t');
+        bool ok = false;
+        if (tab > 0) {
+            entry.timestampUs = line.left(tab).toLongLong(&ok);
+        }
+
+        if (ok) {
+            entry.line = line.mid(tab + 1);
+            lastTimestamp = entry.timestampUs;
+        } else {
+            entry.timestampUs = lastTimestamp;
+            entry.line = line;
+        }
+        trace.append(entry);
+    }
+
+    return trace;
+}
+
+bool TraceFile::save(const Trace &trace, const QString &path)
+{
+    QFile file(path);
+    if (!file.open(QIODevice::WriteOnly | QIODevice::Truncate)) {
+        return false;
+    }
+
+    for (const TraceEntry &entry : trace) {
+        file.write(QByteArray::number(entry.timestampUs) + '\t' + entry.line + '\n');
+    }
+    return true;
+}
+
+static QByteArray toLine(const QJsonObject &event)
+{
+    return QJsonDocument(event).toJson(QJsonDocument::Compact);
+}
+
+static QJsonObject windowJson(quint64 id, quint64 workspaceId, int generation,
+                              bool focused)
+{
+    return QJsonObject{
+        {"id", QJsonValue::fromVariant(id)},
+        {"title", QString("Window %1 - revision %2").arg(id).arg(generation)},
+        {"app_id", QString("org.example.App%1").arg(id % 12)},
+        {"pid", int(1000 + id)},
+        {"workspace_id", QJsonValue::fromVariant(workspaceId)},
+        {"is_focused", focused},
+        {"is_floating", id % 7 == 0},
+        {"is_urgent", false},
+    };
+}
+
+Trace SyntheticTrace::generate(int windowCount, int eventCount, quint32 seed)
+{
+    constexpr int WorkspaceCount = 8;
+    constexpr qint64 EventIntervalUs = 1000;
+
+    QRandomGenerator random(seed);
+    Trace trace;
+    qint64 timestamp = 0;
+
+    auto append = [&](const QJsonObject &event) {
+        trace.append({timestamp, toLine(event)});
+        timestamp += EventIntervalUs;
+    };
+
+    QJsonArray workspaces;
+    for (int i = 0; i < WorkspaceCount; ++i) {
+        workspaces.append(QJsonObject{
+            {"id", i + 1},
+            {"idx", i % (WorkspaceCount / 2) + 1},
+            {"name", QJsonValue()},
+            {"output", i < WorkspaceCount / 2 ? "DP-1" : "HDMI-A-1"},
+            {"is_active", i % (WorkspaceCount / 2) == 0},
+            {"is_focused", i == 0},
+            {"is_urgent", false},
+            {"active_window_id", QJsonValue()},
+        });
+    }
+    append({{"WorkspacesChanged", QJsonObject{{"workspaces", workspaces}}}});
+
+    QList<quint64> windowIds;
+    QList<int> generations;
+    QJsonArray windows;
+    for (int i = 0; i < windowCount; ++i) {
+        quint64 id = i + 1;
+        windowIds.append(id);
+        generations.append(0);
+        windows.append(windowJson(id, i % WorkspaceCount + 1, 0, i == 0));
+    }
+    append({{"WindowsChanged", QJsonObject{{"windows", windows}}}});
+
+    quint64 nextId = windowCount + 1;
+
+    for (int i = 0; i < eventCount && !windowIds.isEmpty(); ++i) {
+        int index = random.bounded(int(windowIds.size()));
+        quint64 id = windowIds[index];
+        quint32 kind = random.bounded(100);
+
+        if (kind < 40) {
+            append({{"WindowFocusChanged", QJsonObject{{"id", QJsonValue::fromVariant(id)}}}});
+        } else if (kind < 70) {
+            QJsonObject window = windowJson(id, id % WorkspaceCount + 1, ++generations[index], true);
+            append({{"WindowOpenedOrChanged", QJsonObject{{"window", window}}}});
+        } else if (kind < 80) {
+            append({{"WindowUrgencyChanged", QJsonObject{
+                {"id", QJsonValue::fromVariant(id)}, {"urgent", random.bounded(2) == 0}}}});
+        } else if (kind < 90) {
+            int workspace = random.bounded(WorkspaceCount) + 1;
+            append({{"WorkspaceActivated", QJsonObject{{"id", workspace}, {"focused", true}}}});
+        } else {
+            // Replace the window with a new one to keep the count stable
+            append({{"WindowClosed", QJsonObject{{"id", QJsonValue::fromVariant(id)}}}});
+            quint64 newId = nextId++;
+            windowIds[index] = newId;
+            generations[index] = 0;
+            QJsonObject window = windowJson(newId, newId % WorkspaceCount + 1, 0, false);
+            append({{"WindowOpenedOrChanged", QJsonObject{{"window", window}}}});
+        }
+    }
+
+    return trace;
+}
+
+qint64 monotonicNanoseconds()
+{
+    using namespace std::chrono;
+    return duration_cast<nanoseconds>(steady_clock::now().time_since_epoch()).count();
+}
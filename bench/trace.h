@@ -0,0 +1,41 @@
+#pragma once
+
+#include <QByteArray>
+#include <QList>
+#include <QString>
+
+/**
+ * One line of a recorded event stream.
+ *
+ * Traces are newline-delimited files of "<monotonic_us>\t<json>" lines, the
+ * format written by the event stream recorder. Lines without a timestamp
+ * are accepted too and replay back to back.
+ */
+struct TraceEntry {
+    qint64 timestampUs = 0;
+    QByteArray line;
+};
+
+using Trace = QList<TraceEntry>;
+
+namespace TraceFile {
+
+// Returns an empty trace and sets error if the file cannot be read
+Trace load(const QString &path, QString *error = nullptr);
+bool save(const Trace &trace, const QString &path);
+
+}
+
+namespace SyntheticTrace {
+
+/**
+ * Generate a deterministic session: workspace and window snapshots followed
+ * by a mix of focus, title, urgency, open/close and workspace switch events
+ * one millisecond apart.
+ */
+Trace generate(int windowCount, int eventCount, quint32 seed = 1);
+
+}
+
+// Steady clock timestamp shared by the server and client threads
+qint64 monotonicNanoseconds();
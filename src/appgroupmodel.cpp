@@ -0,0 +1,270 @@
+#include <QDebug>
+#include "appgroupmodel.h"
+#include "iconresolver.h"
+#include "stringpool.h"
+#include "windowmodel.h"
+
+AppGroupModel::AppGroupModel(WindowModel *source, QObject *parent)
+    : QAbstractListModel(parent)
+    , m_source(source)
+{
+    QObject::connect(source, &QAbstractItemModel::rowsInserted,
+                     this, &AppGroupModel::onRowsInserted);
+    QObject::connect(source, &QAbstractItemModel::rowsAboutToBeRemoved,
+                     this, &AppGroupModel::onRowsAboutToBeRemoved);
+    QObject::connect(source, &QAbstractItemModel::dataChanged,
+                     this, &AppGroupModel::onDataChanged);
+    QObject::connect(source, &QAbstractItemModel::modelReset,
+                     this, &AppGroupModel::rebuild);
+    QObject::connect(IconResolver::instance(), &IconResolver::iconResolved,
+                     this, &AppGroupModel::onIconResolved);
+    // Moves don't change the groups
+
+    onRowsInserted(QModelIndex(), 0, source->rowCount() - 1);
+}
+
+int AppGroupModel::rowCount(const QModelIndex &parent) const
+{
+    if (parent.isValid())
+        return 0;
+    return m_groups.count();
+}
+
+QVariant AppGroupModel::data(const QModelIndex &index, int role) const
+{
+    if (!index.isValid() || index.row() >= m_groups.count())
+        return QVariant();
+
+    const AppGroup &group = m_groups.at(index.row());
+
+    switch (role) {
+    case AppIdRole:
+        return group.appId;
+    case IconPathRole:
+        return group.iconPath;
+    case CountRole:
+        return group.windowIds.count();
+    case AnyUrgentRole:
+        return group.urgentCount > 0;
+    case AnyFocusedRole:
+        return group.focusedCount > 0;
+    case WindowIdsRole: {
+        QVariantList ids;
+        ids.reserve(group.windowIds.count());
+        for (quint64 id : group.windowIds) {
+            ids.append(QVariant::fromValue(id));
+        }
+        return ids;
+    }
+    default:
+        return QVariant();
+    }
+}
+
+QHash<int, QByteArray> AppGroupModel::roleNames() const
+{
+    QHash<int, QByteArray> roles;
+    roles[AppIdRole] = "appId";
+    roles[IconPathRole] = "iconPath";
+    roles[CountRole] = "count";
+    roles[AnyUrgentRole] = "anyUrgent";
+    roles[AnyFocusedRole] = "anyFocused";
+    roles[WindowIdsRole] = "windowIds";
+    return roles;
+}
+
+AppGroupModel::WindowState AppGroupModel::readWindow(int sourceRow, quint64 *id) const
+{
+    QModelIndex idx = m_source->index(sourceRow);
+    *id = m_source->data(idx, WindowModel::IdRole).toULongLong();
+
+    WindowState state;
+    state.appKey = StringPool::key(m_source->data(idx, WindowModel::AppIdRole).toString());
+    state.isUrgent = m_source->data(idx, WindowModel::IsUrgentRole).toBool();
+    state.isFocused = m_source->data(idx, WindowModel::IsFocusedRole).toBool();
+    return state;
+}
+
+void AppGroupModel::addWindow(quint64 id, const WindowState &state)
+{
+    m_windows.insert(id, state);
+
+    int row = m_index.row(state.appKey);
+    if (row == -1) {
+        AppGroup group;
+        group.appId = StringPool::string(state.appKey);
+        // Published without an icon if it's not cached yet, see onIconResolved()
+        group.iconPath = IconResolver::instance()->lookup(group.appId);
+        group.windowIds.append(id);
+        group.urgentCount = state.isUrgent ? 1 : 0;
+        group.focusedCount = state.isFocused ? 1 : 0;
+
+        row = m_groups.count();
+        beginInsertRows(QModelIndex(), row, row);
+        m_groups.append(group);
+        m_index.insert(row, state.appKey);
+        endInsertRows();
+        emit countChanged();
+        return;
+    }
+
+    AppGroup &group = m_groups[row];
+    QList<int> roles = {CountRole, WindowIdsRole};
+    group.windowIds.append(id);
+    if (state.isUrgent && group.urgentCount++ == 0) {
+        roles.append(AnyUrgentRole);
+    }
+    if (state.isFocused && group.focusedCount++ == 0) {
+        roles.append(AnyFocusedRole);
+    }
+    notifyChanged(row, roles);
+}
+
+void AppGroupModel::removeWindow(quint64 id)
+{
+    auto it = m_windows.constFind(id);
+    if (it == m_windows.constEnd()) {
+        qWarning() << "Window not found in app groups:" << id;
+        return;
+    }
+    WindowState state = it.value();
+    m_windows.erase(it);
+
+    int row = m_index.row(state.appKey);
+    AppGroup &group = m_groups[row];
+    group.windowIds.removeOne(id);
+
+    if (group.windowIds.isEmpty()) {
+        beginRemoveRows(QModelIndex(), row, row);
+        m_groups.removeAt(row);
+        m_index.remove(row);
+        endRemoveRows();
+        emit countChanged();
+        return;
+    }
+
+    QList<int> roles = {CountRole, WindowIdsRole};
+    if (state.isUrgent && --group.urgentCount == 0) {
+        roles.append(AnyUrgentRole);
+    }
+    if (state.isFocused && --group.focusedCount == 0) {
+        roles.append(AnyFocusedRole);
+    }
+    notifyChanged(row, roles);
+}
+
+void AppGroupModel::updateWindow(quint64 id, const WindowState &state)
+{
+    auto it = m_windows.find(id);
+    if (it == m_windows.end()) {
+        addWindow(id, state);
+        return;
+    }
+    WindowState &current = it.value();
+
+    if (current.appKey != state.appKey) {
+        removeWindow(id);
+        addWindow(id, state);
+        return;
+    }
+
+    int row = m_index.row(state.appKey);
+    AppGroup &group = m_groups[row];
+    QList<int> roles;
+
+    if (current.isUrgent != state.isUrgent) {
+        group.urgentCount += state.isUrgent ? 1 : -1;
+        if (group.urgentCount == (state.isUrgent ? 1 : 0)) {
+            roles.append(AnyUrgentRole);
+        }
+    }
+    if (current.isFocused != state.isFocused) {
+        group.focusedCount += state.isFocused ? 1 : -1;
+        if (group.focusedCount == (state.isFocused ? 1 : 0)) {
+            roles.append(AnyFocusedRole);
+        }
+    }
+
+    current = state;
+    notifyChanged(row, roles);
+}
+
+void AppGroupModel::notifyChanged(int row, const QList<int> &roles)
+{
+    if (roles.isEmpty()) {
+        return;
+    }
+
+    QModelIndex modelIdx = index(row);
+    emit dataChanged(modelIdx, modelIdx, roles);
+}
+
+void AppGroupModel::rebuild()
+{
+    beginResetModel();
+    int oldCount = m_groups.count();
+    m_groups.clear();
+    m_index.clear();
+    m_windows.clear();
+    endResetModel();
+    if (oldCount) {
+        emit countChanged();
+    }
+
+    if (m_source) {
+        onRowsInserted(QModelIndex(), 0, m_source->rowCount() - 1);
+    }
+}
+
+void AppGroupModel::onRowsInserted(const QModelIndex &parent, int first, int last)
+{
+    if (parent.isValid()) {
+        return;
+    }
+
+    for (int row = first; row <= last; ++row) {
+        quint64 id;
+        WindowState state = readWindow(row, &id);
+        addWindow(id, state);
+    }
+}
+
+void AppGroupModel::onRowsAboutToBeRemoved(const QModelIndex &parent, int first, int last)
+{
+    if (parent.isValid()) {
+        return;
+    }
+
+    for (int row = first; row <= last; ++row) {
+        removeWindow(m_source->data(m_source->index(row), WindowModel::IdRole).toULongLong());
+    }
+}
+
+void AppGroupModel::onDataChanged(const QModelIndex &topLeft, const QModelIndex &bottomRight,
+                                  const QList<int> &roles)
+{
+    // Titles, geometry and the like don't affect the groups
+    if (!roles.isEmpty() &&
+        !roles.contains(WindowModel::AppIdRole) &&
+        !roles.contains(WindowModel::IsUrgentRole) &&
+        !roles.contains(WindowModel::IsFocusedRole)) {
+        return;
+    }
+
+    for (int row = topLeft.row(); row <= bottomRight.row(); ++row) {
+        quint64 id;
+        WindowState state = readWindow(row, &id);
+        updateWindow(id, state);
+    }
+}
+
+void AppGroupModel::onIconResolved(const QString &appId, const QString &iconPath)
+{
+    int row = m_index.row(StringPool::key(appId));
+    if (row == -1 || m_groups[row].iconPath == iconPath) {
+        return;
+    }
+
+    m_groups[row].iconPath = iconPath;
+    notifyChanged(row, {IconPathRole});
+}
@@ -0,0 +1,78 @@
+#pragma once
+
+#include <QAbstractListModel>
+#include <QHash>
+#include <QList>
+#include <QPointer>
+#include "rowindex.h"
+
+class WindowModel;
+
+struct AppGroup {
+    QString appId;
+    QString iconPath;
+    // In the order the windows appeared
+    QList<quint64> windowIds;
+    int urgentCount = 0;
+    int focusedCount = 0;
+};
+
+/**
+ * Windows of a WindowModel grouped by app ID, e.g. for taskbars.
+ *
+ * Groups are kept in the order their first window appeared and are updated
+ * incrementally from the window model's insert, remove and change signals.
+ * The icon is resolved once per group rather than once per window.
+ */
+class AppGroupModel : public QAbstractListModel
+{
+    Q_OBJECT
+    Q_PROPERTY(int count READ rowCount NOTIFY countChanged)
+
+public:
+    enum AppGroupRoles {
+        AppIdRole = Qt::UserRole + 1,
+        IconPathRole,
+        CountRole,
+        AnyUrgentRole,
+        AnyFocusedRole,
+        WindowIdsRole
+    };
+    Q_ENUM(AppGroupRoles)
+
+    explicit AppGroupModel(WindowModel *source, QObject *parent = nullptr);
+
+    int rowCount(const QModelIndex &parent = QModelIndex()) const override;
+    QVariant data(const QModelIndex &index, int role = Qt::DisplayRole) const override;
+    QHash<int, QByteArray> roleNames() const override;
+
+signals:
+    void countChanged();
+
+private:
+    // What the groups depend on, to undo a window's contribution
+    struct WindowState {
+        int appKey;
+        bool isUrgent;
+        bool isFocused;
+    };
+
+    WindowState readWindow(int sourceRow, quint64 *id) const;
+    void addWindow(quint64 id, const WindowState &state);
+    void removeWindow(quint64 id);
+    void updateWindow(quint64 id, const WindowState &state);
+    void notifyChanged(int row, const QList<int> &roles);
+    void rebuild();
+
+    void onRowsInserted(const QModelIndex &parent, int first, int last);
+    void onRowsAboutToBeRemoved(const QModelIndex &parent, int first, int last);
+    void onDataChanged(const QModelIndex &topLeft, const QModelIndex &bottomRight,
+                       const QList<int> &roles);
+    void onIconResolved(const QString &appId, const QString &iconPath);
+
+    QPointer<WindowModel> m_source;
+    QList<AppGroup> m_groups;
+    // Group rows by the StringPool key of their app ID
+    RowIndex m_index;
+    QHash<quint64, WindowState> m_windows;
+};
@@ -0,0 +1,200 @@
+#include "events.h"
+#include "stringpool.h"
+#include <QHash>
+#include <QJsonArray>
+
+// Event tags, indexed by NiriEvent::Type
+static const char *const s_typeNames[NiriEvent::TypeCount] = {
+    "Unknown",
+    "WorkspacesChanged",
+    "WorkspaceUrgencyChanged",
+    "WorkspaceActivated",
+    "WorkspaceActiveWindowChanged",
+    "WindowsChanged",
+    "WindowOpenedOrChanged",
+    "WindowClosed",
+    "WindowFocusChanged",
+    "WindowUrgencyChanged",
+    "WindowLayoutsChanged",
+    "KeyboardLayoutsChanged",
+    "KeyboardLayoutSwitched",
+    "OverviewOpenedOrClosed",
+    "ConfigLoaded",
+};
+
+static NiriEvent::Type eventType(const QString &tag)
+{
+    static const QHash<QString, NiriEvent::Type> types = [] {
+        QHash<QString, NiriEvent::Type> types;
+        for (int type = NiriEvent::Unknown + 1; type < NiriEvent::TypeCount; ++type) {
+            types.insert(QString::fromLatin1(s_typeNames[type]), NiriEvent::Type(type));
+        }
+        return types;
+    }();
+    return types.value(tag, NiriEvent::Unknown);
+}
+
+QString NiriEvent::typeName(Type type)
+{
+    if (type < Unknown || type >= TypeCount) {
+        return QString::fromLatin1(s_typeNames[Unknown]);
+    }
+    return QString::fromLatin1(s_typeNames[type]);
+}
+
+static quint64 optionalId(const QJsonValue &value)
+{
+    return value.isNull() ? 0 : value.toInteger();
+}
+
+NiriEvent NiriEvent::decode(const QJsonObject &obj)
+{
+    NiriEvent event;
+    event.raw = obj;
+
+    // Events are externally tagged: {"WindowClosed": {"id": 1}}
+    if (obj.size() != 1) {
+        return event;
+    }
+
+    auto it = obj.constBegin();
+    event.type = eventType(it.key());
+    const QJsonObject data = it.value().toObject();
+
+    switch (event.type) {
+    case WorkspacesChanged: {
+        Events::WorkspacesChanged payload;
+        const QJsonArray workspaces = data["workspaces"].toArray();
+        payload.workspaces.reserve(workspaces.size());
+        for (const QJsonValue &value : workspaces) {
+            if (value.isObject()) {
+                payload.workspaces.append(parseWorkspace(value.toObject()));
+            }
+        }
+        event.payload = std::move(payload);
+        break;
+    }
+    case WorkspaceUrgencyChanged:
+        event.payload = Events::WorkspaceUrgencyChanged{
+            static_cast<quint64>(data["id"].toInteger()), data["urgent"].toBool()};
+        break;
+    case WorkspaceActivated:
+        event.payload = Events::WorkspaceActivated{
+            static_cast<quint64>(data["id"].toInteger()), data["focused"].toBool()};
+        break;
+    case WorkspaceActiveWindowChanged:
+        event.payload = Events::WorkspaceActiveWindowChanged{
+            static_cast<quint64>(data["workspace_id"].toInteger()),
+            optionalId(data["active_window_id"])};
+        break;
+    case WindowsChanged: {
+        Events::WindowsChanged payload;
+        const QJsonArray windows = data["windows"].toArray();
+        payload.windows.reserve(windows.size());
+        for (const QJsonValue &value : windows) {
+            if (value.isObject()) {
+                payload.windows.append(parseWindow(value.toObject()));
+            }
+        }
+        event.payload = std::move(payload);
+        break;
+    }
+    case WindowOpenedOrChanged:
+        event.payload = Events::WindowOpenedOrChanged{parseWindow(data["window"].toObject())};
+        break;
+    case WindowClosed:
+        event.payload = Events::WindowClosed{static_cast<quint64>(data["id"].toInteger())};
+        break;
+    case WindowFocusChanged:
+        event.payload = Events::WindowFocusChanged{optionalId(data["id"])};
+        break;
+    case WindowUrgencyChanged:
+        event.payload = Events::WindowUrgencyChanged{
+            static_cast<quint64>(data["id"].toInteger()), data["urgent"].toBool()};
+        break;
+    case WindowLayoutsChanged: {
+        // Changes are [id, layout] pairs
+        Events::WindowLayoutsChanged payload;
+        const QJsonArray changes = data["changes"].toArray();
+        payload.changes.reserve(changes.size());
+        for (const QJsonValue &value : changes) {
+            const QJsonArray change = value.toArray();
+            if (change.size() == 2 && change[1].isObject()) {
+                payload.changes.append({static_cast<quint64>(change[0].toInteger()),
+                                        parseWindowLayout(change[1].toObject())});
+            }
+        }
+        event.payload = std::move(payload);
+        break;
+    }
+    default:
+        break;
+    }
+
+    return event;
+}
+
+Workspace NiriEvent::parseWorkspace(const QJsonObject &obj)
+{
+    Workspace ws;
+    ws.id = obj["id"].toInteger();
+    ws.index = obj["idx"].toInt();
+    ws.name = StringPool::intern(obj["name"].toString());
+    ws.output = StringPool::intern(obj["output"].toString(), &ws.outputKey);
+    ws.isActive = obj["is_active"].toBool();
+    ws.isFocused = obj["is_focused"].toBool();
+    ws.isUrgent = obj["is_urgent"].toBool();
+    ws.activeWindowId = optionalId(obj["active_window_id"]);
+
+    return ws;
+}
+
+WindowData NiriEvent::parseWindow(const QJsonObject &obj)
+{
+    WindowData win;
+    win.id = obj["id"].toInteger();
+    win.title = obj["title"].toString();
+    win.appId = StringPool::intern(obj["app_id"].toString());
+
+    QJsonValue pidValue = obj["pid"];
+    win.pid = pidValue.isNull() ? -1 : pidValue.toInt();
+
+    win.workspaceId = optionalId(obj["workspace_id"]);
+    win.isFocused = obj["is_focused"].toBool();
+    win.isFloating = obj["is_floating"].toBool();
+    win.isUrgent = obj["is_urgent"].toBool();
+    win.layout = parseWindowLayout(obj["layout"].toObject());
+
+    return win;
+}
+
+// Pairs such as sizes and positions are encoded as two element arrays
+static QPointF parsePair(const QJsonValue &value)
+{
+    const QJsonArray pair = value.toArray();
+    return pair.size() == 2 ? QPointF(pair[0].toDouble(), pair[1].toDouble()) : QPointF();
+}
+
+WindowLayout NiriEvent::parseWindowLayout(const QJsonObject &obj)
+{
+    WindowLayout layout;
+
+    QPointF tileSize = parsePair(obj["tile_size"]);
+    layout.tileSize = QSizeF(tileSize.x(), tileSize.y());
+    QPointF windowSize = parsePair(obj["window_size"]);
+    layout.windowSize = QSize(qRound(windowSize.x()), qRound(windowSize.y()));
+
+    const QJsonArray position = obj["pos_in_scrolling_layout"].toArray();
+    if (position.size() == 2) {
+        layout.column = position[0].toInt();
+        layout.tile = position[1].toInt();
+    }
+
+    QJsonValue tilePosition = obj["tile_pos_in_workspace_view"];
+    if (tilePosition.isArray()) {
+        layout.tilePosition = parsePair(tilePosition);
+        layout.hasTilePosition = true;
+    }
+
+    return layout;
+}
@@ -0,0 +1,117 @@
+#pragma once
+
+#include <variant>
+#include <QJsonObject>
+#include <QList>
+#include <QMetaType>
+#include <QPair>
+#include <QPointF>
+#include <QSize>
+#include <QSizeF>
+#include <QString>
+
+struct Workspace {
+    quint64 id;
+    quint8 index;
+    QString name;
+    QString output;
+    // StringPool key of output, for cheap comparisons
+    int outputKey;
+    bool isActive;
+    bool isFocused;
+    bool isUrgent;
+    quint64 activeWindowId;
+};
+
+// Position and size of a window in niri's layout, in logical pixels
+struct WindowLayout {
+    QSizeF tileSize;
+    QSize windowSize;
+    // 1-based column and tile in the scrolling layout, 0 for floating windows
+    int column = 0;
+    int tile = 0;
+    // Tile position in the workspace view, only known for floating windows
+    QPointF tilePosition;
+    bool hasTilePosition = false;
+};
+
+struct WindowData {
+    quint64 id = 0;
+    QString title;
+    QString appId;
+    qint32 pid = -1;
+    quint64 workspaceId = 0;
+    bool isFocused = false;
+    bool isFloating = false;
+    bool isUrgent = false;
+    WindowLayout layout;
+};
+
+// Typed payloads of the niri events the models handle
+namespace Events {
+    struct WorkspacesChanged { QList<Workspace> workspaces; };
+    struct WorkspaceUrgencyChanged { quint64 id; bool urgent; };
+    struct WorkspaceActivated { quint64 id; bool focused; };
+    struct WorkspaceActiveWindowChanged { quint64 workspaceId; quint64 activeWindowId; };
+    struct WindowsChanged { QList<WindowData> windows; };
+    struct WindowOpenedOrChanged { WindowData window; };
+    struct WindowClosed { quint64 id; };
+    struct WindowFocusChanged { quint64 id; };
+    struct WindowUrgencyChanged { quint64 id; bool urgent; };
+    struct WindowLayoutsChanged { QList<QPair<quint64, WindowLayout>> changes; };
+}
+
+/**
+ * A niri event, decoded once from its JSON representation.
+ *
+ * The event tag is mapped to a Type, and the payload of the events handled by
+ * the models is parsed into the matching struct from the Events namespace.
+ * Null ids (e.g. no focused window) are decoded as 0. App IDs, output names
+ * and workspace names are interned with StringPool.
+ */
+struct NiriEvent {
+    enum Type {
+        Unknown,
+        WorkspacesChanged,
+        WorkspaceUrgencyChanged,
+        WorkspaceActivated,
+        WorkspaceActiveWindowChanged,
+        WindowsChanged,
+        WindowOpenedOrChanged,
+        WindowClosed,
+        WindowFocusChanged,
+        WindowUrgencyChanged,
+        WindowLayoutsChanged,
+        KeyboardLayoutsChanged,
+        KeyboardLayoutSwitched,
+        OverviewOpenedOrClosed,
+        ConfigLoaded,
+        TypeCount
+    };
+
+    Type type = Unknown;
+    QJsonObject raw;
+    std::variant<std::monostate,
+                 Events::WorkspacesChanged,
+                 Events::WorkspaceUrgencyChanged,
+                 Events::WorkspaceActivated,
+                 Events::WorkspaceActiveWindowChanged,
+                 Events::WindowsChanged,
+                 Events::WindowOpenedOrChanged,
+                 Events::WindowClosed,
+                 Events::WindowFocusChanged,
+                 Events::WindowUrgencyChanged,
+                 Events::WindowLayoutsChanged> payload;
+
+    template<typename T>
+    const T &get() const { return std::get<T>(payload); }
+
+    static NiriEvent decode(const QJsonObject &obj);
+    // The event tag of a type, e.g. "WindowClosed"
+    static QString typeName(Type type);
+    static Workspace parseWorkspace(const QJsonObject &obj);
+    static WindowData parseWindow(const QJsonObject &obj);
+    static WindowLayout parseWindowLayout(const QJsonObject &obj);
+};
+
+Q_DECLARE_METATYPE(NiriEvent)
@@ -0,0 +1,127 @@
+#include "eventstream.h"
+#include "niristats.h"
+#include "tracerecorder.h"
+#include <QJsonDocument>
+#include <QDebug>
+
+EventStream::EventStream(QObject *parent)
+    : QObject(parent)
+    , m_socket(new QLocalSocket(this))
+{
+    QObject::connect(m_socket, &QLocalSocket::connected,
+                     this, &EventStream::onConnected);
+    QObject::connect(m_socket, &QLocalSocket::readyRead,
+                     this, &EventStream::onReadyRead);
+    QObject::connect(m_socket, &QLocalSocket::errorOccurred,
+                     this, &EventStream::onSocketError);
+    QObject::connect(m_socket, &QLocalSocket::disconnected,
+                     this, &EventStream::onDisconnected);
+}
+
+EventStream::~EventStream()
+{
+    close();
+}
+
+void EventStream::open(const QString &socketPath)
+{
+    m_framer.clear();
+    m_socket->connectToServer(socketPath);
+}
+
+void EventStream::onConnected()
+{
+    qDebug() << "Listening to niri event stream ...";
+    QByteArray data = "\"EventStream\"\n";
+    qint64 written = m_socket->write(data);
+    if (written != data.size()) {
+        emit errorOccurred("Failed to write event stream request");
+        m_socket->abort();
+        return;
+    }
+    m_socket->flush();
+
+    m_connected = true;
+    emit connected();
+}
+
+void EventStream::close()
+{
+    if (m_socket->isOpen()) {
+        m_socket->close();
+    }
+    m_connected = false;
+}
+
+void EventStream::onReadyRead()
+{
+    QByteArray data = m_socket->readAll();
+
+    NiriStats *stats = NiriStats::instance();
+    if (stats->enabled()) {
+        stats->recordRead(data.size());
+    }
+
+    // Process complete lines (events are newline-delimited)
+    m_framer.append(data, [this](const QByteArray &line) {
+        // Replies aren't part of the trace, replay servers send their own
+        if (m_recorder && !line.startsWith("{\"Ok\"") && !line.startsWith("{\"Err\"")) {
+            m_recorder->record(line);
+        }
+        handleLine(line);
+    });
+}
+
+void EventStream::handleLine(const QByteArray &line)
+{
+    NiriStats *stats = NiriStats::instance();
+    qint64 start = stats->enabled() ? NiriStats::now() : 0;
+
+    QJsonParseError parseError;
+    QJsonDocument doc = QJsonDocument::fromJson(line, &parseError);
+
+    if (parseError.error != QJsonParseError::NoError) {
+        qWarning() << "JSON parse error:" << parseError.errorString();
+        return;
+    }
+
+    if (doc.isObject()) {
+        QJsonObject obj = doc.object();
+
+        // First response is the Reply to EventStream request
+        if (obj.contains("Ok") || obj.contains("Err")) {
+            if (obj.contains("Err")) {
+                emit errorOccurred("Event stream request failed: " +
+                                  obj["Err"].toString());
+            }
+            return;
+        }
+
+        // Subsequent messages are Events
+        NiriEvent event = NiriEvent::decode(obj);
+        if (start) {
+            stats->recordSpan(NiriStats::ParseSpan, start, NiriStats::now());
+        }
+        emit eventReceived(event);
+    }
+}
+
+void EventStream::onSocketError()
+{
+    if (m_connected) {
+        emit errorOccurred(m_socket->errorString());
+        return;
+    }
+
+    // A failed connection attempt never reaches the disconnected state
+    emit errorOccurred("Failed to connect event socket: " + m_socket->errorString());
+    if (m_socket->state() == QLocalSocket::UnconnectedState) {
+        emit disconnected();
+    }
+}
+
+void EventStream::onDisconnected()
+{
+    m_connected = false;
+    emit disconnected();
+}
@@ -0,0 +1,60 @@
+#pragma once
+
+#include <atomic>
+#include <QObject>
+#include <QLocalSocket>
+#include "events.h"
+#include "lineframer.h"
+
+class TraceRecorder;
+
+/**
+ * Reads and parses the niri event stream.
+ *
+ * The stream owns its own socket, so it can either live on the GUI thread or
+ * be moved to a dedicated worker thread by IPCClient. In the latter case only
+ * decoded events cross the thread boundary.
+ */
+class EventStream : public QObject
+{
+    Q_OBJECT
+
+public:
+    explicit EventStream(QObject *parent = nullptr);
+    ~EventStream();
+
+    // Safe to call from any thread
+    bool isConnected() const { return m_connected; }
+
+    // Tee raw event lines to recorder; set before open()
+    void setRecorder(TraceRecorder *recorder) { m_recorder = recorder; }
+
+public slots:
+    /**
+     * Start connecting without blocking. Emits connected() once the
+     * EventStream request has been sent, or disconnected() if the
+     * connection attempt fails.
+     */
+    void open(const QString &socketPath);
+    void close();
+
+signals:
+    void connected();
+    void eventReceived(const NiriEvent &event);
+    void errorOccurred(const QString &error);
+    void disconnected();
+
+private slots:
+    void onConnected();
+    void onReadyRead();
+    void onSocketError();
+    void onDisconnected();
+
+private:
+    void handleLine(const QByteArray &line);
+
+    QLocalSocket *m_socket = nullptr;
+    LineFramer m_framer;
+    TraceRecorder *m_recorder = nullptr;
+    std::atomic<bool> m_connected{false};
+};
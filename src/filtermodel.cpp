@@ -0,0 +1,236 @@
+#include <algorithm>
+#include "filtermodel.h"
+
+FilterModel::FilterModel(QAbstractItemModel *source, int filterRole,
+                         const QVariant &filterValue, QObject *parent)
+    : QAbstractListModel(parent)
+    , m_source(source)
+    , m_filterRole(filterRole)
+    , m_filterValue(filterValue)
+{
+    QObject::connect(source, &QAbstractItemModel::rowsInserted,
+                     this, &FilterModel::onRowsInserted);
+    QObject::connect(source, &QAbstractItemModel::rowsAboutToBeRemoved,
+                     this, &FilterModel::onRowsAboutToBeRemoved);
+    QObject::connect(source, &QAbstractItemModel::rowsRemoved,
+                     this, &FilterModel::onRowsRemoved);
+    QObject::connect(source, &QAbstractItemModel::rowsMoved,
+                     this, &FilterModel::onRowsMoved);
+    QObject::connect(source, &QAbstractItemModel::dataChanged,
+                     this, &FilterModel::onDataChanged);
+    QObject::connect(source, &QAbstractItemModel::modelReset,
+                     this, &FilterModel::rebuild);
+    QObject::connect(source, &QAbstractItemModel::layoutChanged,
+                     this, &FilterModel::rebuild);
+    // Views are owned by QML and may outlive their source
+    QObject::connect(source, &QObject::destroyed, this, [this] {
+        beginResetModel();
+        m_rows.clear();
+        endResetModel();
+        emit countChanged();
+    });
+
+    for (int row = 0; row < source->rowCount(); ++row) {
+        if (accepts(row)) {
+            m_rows.append(row);
+        }
+    }
+}
+
+int FilterModel::rowCount(const QModelIndex &parent) const
+{
+    if (parent.isValid())
+        return 0;
+    return m_rows.count();
+}
+
+QVariant FilterModel::data(const QModelIndex &index, int role) const
+{
+    if (!m_source || !index.isValid() || index.row() >= m_rows.count())
+        return QVariant();
+
+    return m_source->data(m_source->index(m_rows.at(index.row()), 0), role);
+}
+
+QHash<int, QByteArray> FilterModel::roleNames() const
+{
+    return m_source ? m_source->roleNames() : QHash<int, QByteArray>();
+}
+
+bool FilterModel::accepts(int sourceRow) const
+{
+    return m_source->data(m_source->index(sourceRow, 0), m_filterRole) == m_filterValue;
+}
+
+int FilterModel::lowerBound(int sourceRow) const
+{
+    return std::lower_bound(m_rows.cbegin(), m_rows.cend(), sourceRow) - m_rows.cbegin();
+}
+
+void FilterModel::shiftRows(int fromProxyRow, int delta)
+{
+    for (int i = fromProxyRow; i < m_rows.count(); ++i) {
+        m_rows[i] += delta;
+    }
+}
+
+void FilterModel::rebuild()
+{
+    beginResetModel();
+    m_rows.clear();
+    for (int row = 0; m_source && row < m_source->rowCount(); ++row) {
+        if (accepts(row)) {
+            m_rows.append(row);
+        }
+    }
+    endResetModel();
+    emit countChanged();
+}
+
+void FilterModel::onRowsInserted(const QModelIndex &parent, int first, int last)
+{
+    if (parent.isValid()) {
+        return;
+    }
+
+    int proxyRow = lowerBound(first);
+    shiftRows(proxyRow, last - first + 1);
+
+    QList<int> accepted;
+    for (int row = first; row <= last; ++row) {
+        if (accepts(row)) {
+            accepted.append(row);
+        }
+    }
+    if (accepted.isEmpty()) {
+        return;
+    }
+
+    // The new rows are contiguous in the source, so they are in the proxy too
+    beginInsertRows(QModelIndex(), proxyRow, proxyRow + accepted.count() - 1);
+    for (int i = 0; i < accepted.count(); ++i) {
+        m_rows.insert(proxyRow + i, accepted[i]);
+    }
+    endInsertRows();
+    emit countChanged();
+}
+
+void FilterModel::onRowsAboutToBeRemoved(const QModelIndex &parent, int first, int last)
+{
+    if (parent.isValid()) {
+        return;
+    }
+
+    int proxyFirst = lowerBound(first);
+    int proxyLast = lowerBound(last + 1) - 1;
+    if (proxyFirst > proxyLast) {
+        return;
+    }
+
+    beginRemoveRows(QModelIndex(), proxyFirst, proxyLast);
+    m_rows.remove(proxyFirst, proxyLast - proxyFirst + 1);
+    endRemoveRows();
+    emit countChanged();
+}
+
+void FilterModel::onRowsRemoved(const QModelIndex &parent, int first, int last)
+{
+    if (parent.isValid()) {
+        return;
+    }
+
+    // The removed rows themselves are already gone from the mapping
+    shiftRows(lowerBound(first), -(last - first + 1));
+}
+
+void FilterModel::onRowsMoved(const QModelIndex &parent, int start, int end,
+                              const QModelIndex &destination, int destinationRow)
+{
+    if (parent.isValid() || destination.isValid()) {
+        return;
+    }
+
+    // Where each source row went, as in QList::move() for a block
+    int count = end - start + 1;
+    int newStart = destinationRow > end ? destinationRow - count : destinationRow;
+    auto movedRow = [=](int row) {
+        if (row >= start && row <= end) {
+            return row - start + newStart;
+        }
+        if (destinationRow > end && row > end && row < destinationRow) {
+            return row - count;
+        }
+        if (destinationRow < start && row >= destinationRow && row < start) {
+            return row + count;
+        }
+        return row;
+    };
+
+    int proxyFirst = lowerBound(start);
+    int proxyLast = lowerBound(end + 1) - 1;
+
+    QList<int> rows;
+    rows.reserve(m_rows.count());
+    for (int row : std::as_const(m_rows)) {
+        rows.append(movedRow(row));
+    }
+    std::sort(rows.begin(), rows.end());
+
+    if (proxyFirst > proxyLast) {
+        // None of the moved rows are in the filter, so the order is kept
+        m_rows = rows;
+        return;
+    }
+
+    int proxyDestination = std::lower_bound(rows.cbegin(), rows.cend(), newStart) - rows.cbegin();
+    if (proxyDestination == proxyFirst) {
+        m_rows = rows;
+        return;
+    }
+
+    // beginMoveRows() takes the destination before the move
+    int moveDestination = proxyDestination > proxyFirst
+        ? proxyDestination + (proxyLast - proxyFirst + 1)
+        : proxyDestination;
+    beginMoveRows(QModelIndex(), proxyFirst, proxyLast, QModelIndex(), moveDestination);
+    m_rows = rows;
+    endMoveRows();
+}
+
+void FilterModel::onDataChanged(const QModelIndex &topLeft, const QModelIndex &bottomRight,
+                                const QList<int> &roles)
+{
+    if (topLeft.parent().isValid()) {
+        return;
+    }
+
+    int first = topLeft.row();
+    int last = bottomRight.row();
+
+    if (roles.isEmpty() || roles.contains(m_filterRole)) {
+        // Membership may have changed; handle rows entering or leaving
+        for (int row = first; row <= last; ++row) {
+            int proxyRow = lowerBound(row);
+            bool mapped = proxyRow < m_rows.count() && m_rows[proxyRow] == row;
+            bool accepted = accepts(row);
+
+            if (accepted && !mapped) {
+                beginInsertRows(QModelIndex(), proxyRow, proxyRow);
+                m_rows.insert(proxyRow, row);
+                endInsertRows();
+                emit countChanged();
+            } else if (!accepted && mapped) {
+                beginRemoveRows(QModelIndex(), proxyRow, proxyRow);
+                m_rows.removeAt(proxyRow);
+                endRemoveRows();
+                emit countChanged();
+            }
+        }
+    }
+
+    int proxyFirst = lowerBound(first);
+    int proxyLast = lowerBound(last + 1) - 1;
+    if (proxyFirst <= proxyLast) {
+        emit dataChanged(index(proxyFirst), index(proxyLast), roles);
+    }
+}
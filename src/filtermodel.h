@@ -0,0 +1,52 @@
+#pragma once
+
+#include <QAbstractListModel>
+#include <QList>
+#include <QPointer>
+#include <QVariant>
+
+/**
+ * Rows of a list model whose filter role equals a fixed value.
+ *
+ * Unlike QSortFilterProxyModel, the mapping is kept as a sorted list of
+ * source rows that is updated incrementally from the source's insert,
+ * remove, move and change signals. Changes to rows outside the filter
+ * only cost a binary search and emit nothing.
+ */
+class FilterModel : public QAbstractListModel
+{
+    Q_OBJECT
+    Q_PROPERTY(int count READ rowCount NOTIFY countChanged)
+
+public:
+    FilterModel(QAbstractItemModel *source, int filterRole, const QVariant &filterValue,
+                QObject *parent = nullptr);
+
+    int rowCount(const QModelIndex &parent = QModelIndex()) const override;
+    QVariant data(const QModelIndex &index, int role = Qt::DisplayRole) const override;
+    QHash<int, QByteArray> roleNames() const override;
+
+signals:
+    void countChanged();
+
+private:
+    bool accepts(int sourceRow) const;
+    // Proxy row of the first mapped source row >= sourceRow
+    int lowerBound(int sourceRow) const;
+    void shiftRows(int fromProxyRow, int delta);
+    void rebuild();
+
+    void onRowsInserted(const QModelIndex &parent, int first, int last);
+    void onRowsAboutToBeRemoved(const QModelIndex &parent, int first, int last);
+    void onRowsRemoved(const QModelIndex &parent, int first, int last);
+    void onRowsMoved(const QModelIndex &parent, int start, int end,
+                     const QModelIndex &destination, int destinationRow);
+    void onDataChanged(const QModelIndex &topLeft, const QModelIndex &bottomRight,
+                       const QList<int> &roles);
+
+    QPointer<QAbstractItemModel> m_source;
+    int m_filterRole;
+    QVariant m_filterValue;
+    // Source rows in the filter, ascending
+    QList<int> m_rows;
+};
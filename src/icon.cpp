@@ -1,26 +1,213 @@
 #include "icon.h"
+#include "iconcache.h"
+#include <algorithm>
+#include <atomic>
+#include <memory>
 #include <QFile>
 #include <QDir>
+#include <QDataStream>
 #include <QDebug>
-#include <QIcon>
+#include <QDirIterator>
+#include <QElapsedTimer>
+#include <QMutex>
 #include <QProcessEnvironment>
+#include <QSaveFile>
+#include <QSet>
 #include <QStandardPaths>
 #include <QTextStream>
 
 namespace IconLookup {
 
-// Cache for appId -> iconPath mappings
-static QHash<QString, QString> s_cache;
+// Cache for appId -> iconPath mappings, shared by all threads
+static IconCache s_cache;
+// Whether the cache is persisted, and has entries that weren't saved yet
+static std::atomic<bool> s_persistent{false};
+static std::atomic<bool> s_dirty{false};
 
-QString lookup(const QString &appId)
+// System icon theme, set from the GUI thread
+static QString s_themeName;
+static QMutex s_themeNameMutex;
+
+static const quint32 s_persistentCacheMagic = 0x4e495249; // "NIRI"
+static const quint32 s_persistentCacheVersion = 3;
+
+// Directories the loaded cache was validated against, and the ones that were
+// watched when it was saved. Its entries still depend on them, even if no
+// index was built since.
+static QStringList s_loadedDirectories;
+static QStringList s_loadedWatchedDirectories;
+static QMutex s_loadedDirectoriesMutex;
+
+// Bumped by invalidate(), so that results resolved from the indexes it drops
+// aren't stored after it re-resolved the cached app IDs
+static quint64 s_generation = 0;
+static QMutex s_generationMutex;
+
+static void storeInCache(const QString &appId, const QString &iconPath)
+{
+    s_cache.insert(appId, iconPath);
+    s_dirty = true;
+}
+
+// Store a result resolved as of the given generation, unless an invalidation
+// happened since
+static bool storeInCache(const QString &appId, const QString &iconPath, quint64 generation)
+{
+    QMutexLocker locker(&s_generationMutex);
+    if (generation != s_generation) {
+        return false;
+    }
+    storeInCache(appId, iconPath);
+    return true;
+}
+
+static quint64 currentGeneration()
+{
+    QMutexLocker locker(&s_generationMutex);
+    return s_generation;
+}
+
+static QString persistentCachePath()
+{
+    return QStandardPaths::writableLocation(QStandardPaths::GenericCacheLocation)
+        + "/qml-niri/icon-cache";
+}
+
+using Fingerprint = QList<QPair<QString, qint64>>;
+
+// Modification times of the directories whose contents the cached results
+// depend on. Adding or removing desktop files, icons or themes changes them.
+static Fingerprint directoryFingerprint(const QStringList &dirs)
+{
+    Fingerprint fingerprint;
+    fingerprint.reserve(dirs.count());
+    for (const QString &dir : dirs) {
+        QFileInfo info(dir);
+        fingerprint.append({dir, info.exists() ? info.lastModified().toMSecsSinceEpoch() : -1});
+    }
+    return fingerprint;
+}
+
+// The directories read to resolve the cached entries, down to the ones
+// holding desktop files and icons
+static QStringList fingerprintDirectories()
+{
+    QStringList dirs;
+    {
+        QMutexLocker locker(&s_loadedDirectoriesMutex);
+        dirs = s_loadedDirectories;
+    }
+    dirs.append(Internal::indexedDirectories());
+    dirs.removeDuplicates();
+    return dirs;
+}
+
+static void loadPersistentCache()
+{
+    QFile file(persistentCachePath());
+    if (!file.open(QIODevice::ReadOnly)) {
+        return;
+    }
+
+    QDataStream in(&file);
+    in.setVersion(QDataStream::Qt_6_0);
+
+    quint32 magic = 0;
+    quint32 version = 0;
+    QString storedTheme;
+    Fingerprint fingerprint;
+    QStringList watched;
+    QHash<QString, QString> entries;
+    in >> magic >> version;
+    if (magic != s_persistentCacheMagic || version != s_persistentCacheVersion) {
+        return;
+    }
+    in >> storedTheme >> fingerprint >> watched >> entries;
+    if (in.status() != QDataStream::Ok) {
+        qWarning() << "Failed to read icon cache:" << file.fileName();
+        return;
+    }
+
+    // Only the stored directories are checked, so that a valid cache doesn't
+    // cost any directory listing.
+    QStringList dirs;
+    for (const auto &dir : std::as_const(fingerprint)) {
+        dirs.append(dir.first);
+    }
+    if (storedTheme != themeName() || directoryFingerprint(dirs) != fingerprint) {
+        qDebug() << "Icon cache is outdated:" << file.fileName();
+        return;
+    }
+
+    {
+        QMutexLocker locker(&s_loadedDirectoriesMutex);
+        s_loadedDirectories = dirs;
+        s_loadedWatchedDirectories = watched;
+    }
+    s_cache.insertMissing(entries);
+    qDebug() << "Loaded" << entries.count() << "cached icons from" << file.fileName();
+}
+
+void setPersistentCacheEnabled(bool enabled)
+{
+    if (s_persistent.exchange(enabled) == enabled) {
+        return;
+    }
+
+    if (enabled) {
+        loadPersistentCache();
+    }
+}
+
+bool persistentCacheEnabled()
 {
-    if (s_cache.contains(appId)) {
-        return s_cache[appId];
+    return s_persistent;
+}
+
+void savePersistentCache()
+{
+    if (!s_persistent || !s_dirty.exchange(false)) {
+        return;
     }
+    QHash<QString, QString> entries = s_cache.entries();
+
+    QString path = persistentCachePath();
+    QDir().mkpath(QFileInfo(path).absolutePath());
 
+    QSaveFile file(path);
+    if (!file.open(QIODevice::WriteOnly)) {
+        qWarning() << "Failed to write icon cache:" << path;
+        return;
+    }
+
+    QDataStream out(&file);
+    out.setVersion(QDataStream::Qt_6_0);
+    out << s_persistentCacheMagic << s_persistentCacheVersion
+        << themeName() << directoryFingerprint(fingerprintDirectories())
+        << watchedDirectories() << entries;
+
+    if (!file.commit()) {
+        qWarning() << "Failed to write icon cache:" << path;
+    }
+}
+
+std::optional<QString> cached(const QString &appId)
+{
+    return s_cache.get(appId);
+}
+
+std::optional<QString> peek(const QString &appId)
+{
+    return s_cache.peek(appId);
+}
+
+// Resolve the icon path for an app ID, bypassing the cache
+static QString resolve(const QString &appId)
+{
     QString result;
 
-    QString desktopFile = Internal::findDesktopFile(appId);
+    Internal::DesktopEntry entry = Internal::findDesktopEntry(appId);
+    const QString &desktopFile = entry.path;
     if (desktopFile.isEmpty()) {
         qDebug() << "No desktop file found for app ID:" << appId;
         // Try fallback: direct icon theme lookup using the appId
@@ -31,17 +218,15 @@ QString lookup(const QString &appId)
         } else {
             qDebug() << "No fallback icon found for" << appId;
         }
-        s_cache[appId] = result;
         return result;
     }
 
     qDebug() << "Found desktop file for" << appId << ":" << desktopFile;
 
-    // Parse the Icon= field from desktop file
-    QString iconValue = Internal::parseIconFromDesktopFile(desktopFile);
+    // The Icon= field was parsed when indexing desktop entries
+    const QString &iconValue = entry.icon;
     if (iconValue.isEmpty()) {
         qDebug() << "No Icon field found in desktop file:" << desktopFile;
-        s_cache[appId] = result;
         return result;
     }
 
@@ -57,13 +242,140 @@ QString lookup(const QString &appId)
         qDebug() << "Could not resolve icon path for" << appId;
     }
 
-    s_cache[appId] = result;
     return result;
 }
 
+QString lookup(const QString &appId)
+{
+    if (std::optional<QString> path = cached(appId)) {
+        return *path;
+    }
+    return resolveUncached(appId);
+}
+
+QString resolveUncached(const QString &appId)
+{
+    // Resolve again if the indexes were invalidated meanwhile, as the result
+    // may come from the old ones
+    for (;;) {
+        quint64 generation = currentGeneration();
+        QString result = resolve(appId);
+        if (storeInCache(appId, result, generation)) {
+            return result;
+        }
+    }
+}
+
+QStringList watchedDirectories()
+{
+    // Only the directories the indexes already listed, so that this doesn't
+    // walk any directory trees
+    QStringList dirs;
+    {
+        QMutexLocker locker(&s_loadedDirectoriesMutex);
+        dirs = s_loadedWatchedDirectories;
+    }
+
+    // Desktop files being added or removed
+    dirs.append(Internal::indexedDesktopDirectories());
+    // Themes being added or removed, and icon caches being updated
+    dirs.append(Internal::indexedThemeDirectories());
+    // Application icon directories, only once the theme index was needed
+    dirs.append(Internal::indexedIconDirectories());
+
+    dirs.removeDuplicates();
+    return dirs;
+}
+
+QHash<QString, QString> invalidate(const QStringList &changedDirs)
+{
+    QStringList appsDirs;
+    for (const QString &dataDir : Internal::getXdgDataDirs()) {
+        appsDirs.append(dataDir + "/applications");
+    }
+
+    bool desktopEntriesChanged = false;
+    bool iconsChanged = false;
+    for (const QString &dir : changedDirs) {
+        bool isAppsDir = std::any_of(appsDirs.begin(), appsDirs.end(), [&dir](const QString &appsDir) {
+            return dir == appsDir || dir.startsWith(appsDir + "/");
+        });
+        if (isAppsDir) {
+            desktopEntriesChanged = true;
+        } else {
+            iconsChanged = true;
+        }
+    }
+
+    if (desktopEntriesChanged) {
+        Internal::clearDesktopEntryIndex();
+    }
+    if (iconsChanged) {
+        Internal::clearIconThemeIndex();
+    }
+
+    // Bumped only once the indexes are dropped, so that a lookup that sees
+    // the new generation also resolves from the rebuilt indexes. Lookups in
+    // flight either stored their result already, and it's resolved again
+    // below, or they notice and resolve it again themselves.
+    {
+        QMutexLocker locker(&s_generationMutex);
+        ++s_generation;
+    }
+
+    QHash<QString, QString> entries = s_cache.entries();
+
+    // Resolving from the rebuilt indexes is done in memory, so only the app
+    // IDs whose result changed are updated and reported.
+    QHash<QString, QString> changed;
+    for (auto it = entries.constBegin(); it != entries.constEnd(); ++it) {
+        QString path = resolve(it.key());
+        if (path != it.value()) {
+            changed.insert(it.key(), path);
+        }
+    }
+
+    if (!changed.isEmpty()) {
+        for (auto it = changed.constBegin(); it != changed.constEnd(); ++it) {
+            s_cache.insert(it.key(), it.value());
+        }
+        s_dirty = true;
+    }
+
+    return changed;
+}
+
+CacheStats cacheStats()
+{
+    IconCache::Stats stats = s_cache.stats();
+    return {stats.hits, stats.misses, stats.evictions, stats.size};
+}
+
+bool setThemeName(const QString &name)
+{
+    {
+        QMutexLocker locker(&s_themeNameMutex);
+        if (s_themeName == name) {
+            return false;
+        }
+        s_themeName = name;
+    }
+
+    Internal::clearIconThemeIndex();
+    return true;
+}
+
+QString themeName()
+{
+    QMutexLocker locker(&s_themeNameMutex);
+    return s_themeName;
+}
+
 void clearCache()
 {
     s_cache.clear();
+    Internal::clearIconThemeIndex();
+    Internal::clearDesktopEntryIndex();
 }
 
 namespace Internal {
@@ -84,71 +396,167 @@ QStringList getXdgDataDirs()
     return dirs;
 }
 
-QString findDesktopFile(const QString &appId)
+// Desktop entry index, built once by scanning all applications directories
+struct DesktopEntryIndex {
+    // Entries with an icon, in precedence order
+    QList<DesktopEntry> entries;
+    QList<QString> lowerIds;
+
+    QHash<QString, int> byId;
+    QHash<QString, int> byLowerId;
+    QHash<QString, int> byWmClass;
+
+    // Directories scanned, including missing applications directories
+    QStringList directories;
+};
+
+static std::shared_ptr<const DesktopEntryIndex> s_desktopIndex;
+static QMutex s_desktopIndexMutex;
+
+static std::shared_ptr<const DesktopEntryIndex> buildDesktopEntryIndex()
 {
-    QStringList dataDirs = getXdgDataDirs();
+    QElapsedTimer timer;
+    timer.start();
 
-    // Search patterns in priority order
-    QStringList patterns = {
-        appId + ".desktop",
-        appId.toLower() + ".desktop",
-        "*" + appId.toLower() + "*.desktop"
-    };
+    auto index = std::make_shared<DesktopEntryIndex>();
+    // File ids seen so far, including hidden entries, which mask entries with
+    // the same id in lower precedence directories
+    QSet<QString> seenIds;
 
-    QStringList prefixes = {
-        "applications/",
-        "applications/kde/",
-        "applications/org.kde."
+    auto addKey = [&index](QHash<QString, int> &keys, const QString &key) {
+        if (!key.isEmpty() && !keys.contains(key)) {
+            keys.insert(key, index->entries.count() - 1);
+        }
     };
 
-    QStringList candidates;
+    for (const QString &dataDir : getXdgDataDirs()) {
+        QString appsDir = dataDir + "/applications";
+        index->directories.append(appsDir);
+        if (!QDir(appsDir).exists()) {
+            continue;
+        }
 
-    for (const QString &dir : dataDirs) {
-        for (const QString &prefix : prefixes) {
-            QString searchDir = dir + "/" + prefix;
-            QDir directory(searchDir);
+        // Subdirectories are listed too, as adding a desktop file to one
+        // only changes its own modification time
+        QStringList files;
+        QDirIterator it(appsDir, {"*.desktop"}, QDir::Files | QDir::AllDirs | QDir::NoDotAndDotDot,
+                        QDirIterator::Subdirectories);
+        while (it.hasNext()) {
+            QString path = it.next();
+            if (it.fileInfo().isDir()) {
+                index->directories.append(path);
+            } else {
+                files.append(path);
+            }
+        }
+        files.sort();
 
-            if (!directory.exists()) continue;
+        for (const QString &path : std::as_const(files)) {
+            // The desktop file id is the path relative to applications/, with
+            // '/' replaced by '-', e.g. kde/foo.desktop -> kde-foo
+            QString relative = path.mid(appsDir.size() + 1);
+            relative.chop(8); // ".desktop"
+            QString id = QString(relative).replace('/', '-');
 
-            for (const QString &pattern : patterns) {
-                if (!pattern.contains('*')) {
-                    QString path = directory.absoluteFilePath(pattern);
-                    if (QFileInfo(path).isFile()) {
-                        candidates.append(path);
-                    }
-                } else {
-                    QStringList matches = directory.entryList(
-                        {pattern}, QDir::Files, QDir::Name
-                    );
-                    for (const QString &match : matches) {
-                        candidates.append(directory.absoluteFilePath(match));
-                    }
-                }
+            if (seenIds.contains(id)) {
+                continue;
+            }
+            seenIds.insert(id);
+
+            DesktopEntry entry = parseDesktopEntry(path);
+            if (entry.hidden || entry.icon.isEmpty()) {
+                continue;
+            }
+
+            QString lowerId = id.toLower();
+            index->entries.append(entry);
+            index->lowerIds.append(lowerId);
+
+            addKey(index->byId, id);
+            addKey(index->byLowerId, lowerId);
+            addKey(index->byWmClass, entry.startupWMClass.toLower());
+
+            // Also match entries in subdirectories by file name, e.g.
+            // kde/foo.desktop by "foo"
+            int slash = relative.lastIndexOf('/');
+            if (slash != -1) {
+                QString name = relative.mid(slash + 1);
+                addKey(index->byId, name);
+                addKey(index->byLowerId, name.toLower());
             }
         }
     }
 
-    for (const QString &candidate : candidates) {
-        QString iconValue = parseIconFromDesktopFile(candidate);
-        if (!iconValue.isEmpty()) {
-            return candidate;
+    qDebug() << "Built desktop entry index with" << index->entries.count()
+             << "entries in" << timer.elapsed() << "ms";
+
+    return index;
+}
+
+static std::shared_ptr<const DesktopEntryIndex> desktopEntryIndex()
+{
+    QMutexLocker locker(&s_desktopIndexMutex);
+    if (!s_desktopIndex) {
+        s_desktopIndex = buildDesktopEntryIndex();
+    }
+    return s_desktopIndex;
+}
+
+void clearDesktopEntryIndex()
+{
+    QMutexLocker locker(&s_desktopIndexMutex);
+    s_desktopIndex.reset();
+}
+
+DesktopEntry findDesktopEntry(const QString &appId)
+{
+    if (appId.isEmpty()) {
+        return DesktopEntry();
+    }
+
+    std::shared_ptr<const DesktopEntryIndex> index = desktopEntryIndex();
+    QString lowerAppId = appId.toLower();
+
+    // Match in priority order: exact file id, lowercase file id,
+    // StartupWMClass, then any file id containing the app ID
+    int found = index->byId.value(appId, -1);
+    if (found == -1) {
+        found = index->byLowerId.value(lowerAppId, -1);
+    }
+    if (found == -1) {
+        found = index->byWmClass.value(lowerAppId, -1);
+    }
+    if (found == -1) {
+        for (int i = 0; i < index->lowerIds.count(); ++i) {
+            if (index->lowerIds[i].contains(lowerAppId)) {
+                found = i;
+                break;
+            }
         }
     }
 
-    return QString();
+    return found == -1 ? DesktopEntry() : index->entries[found];
 }
 
-QString parseIconFromDesktopFile(const QString &desktopFilePath)
+QString findDesktopFile(const QString &appId)
 {
+    return findDesktopEntry(appId).path;
+}
+
+DesktopEntry parseDesktopEntry(const QString &desktopFilePath)
+{
+    DesktopEntry entry;
+
     QFile file(desktopFilePath);
     if (!file.open(QIODevice::ReadOnly | QIODevice::Text)) {
         qWarning() << "Failed to open desktop file:" << desktopFilePath;
-        return QString();
+        return entry;
     }
 
+    entry.path = desktopFilePath;
+
     QTextStream in(&file);
     bool inDesktopEntry = false;
-    QString iconValue;
 
     while (!in.atEnd()) {
         QString line = in.readLine().trimmed();
@@ -170,15 +578,27 @@ QString parseIconFromDesktopFile(const QString &desktopFilePath)
             continue;
         }
 
-        // Look for Icon= key in Desktop Entry section
-        if (inDesktopEntry && line.startsWith("Icon=")) {
-            iconValue = line.mid(5).trimmed();
-            break;
+        if (!inDesktopEntry) {
+            continue;
+        }
+
+        // Look for the keys we need in the Desktop Entry section
+        if (line.startsWith("Icon=")) {
+            entry.icon = line.mid(5).trimmed();
+        } else if (line.startsWith("StartupWMClass=")) {
+            entry.startupWMClass = line.mid(15).trimmed();
+        } else if (line.startsWith("Hidden=")) {
+            entry.hidden = (line.mid(7).trimmed() == "true");
         }
     }
 
     file.close();
-    return iconValue;
+    return entry;
+}
+
+QString parseIconFromDesktopFile(const QString &desktopFilePath)
+{
+    return parseDesktopEntry(desktopFilePath).icon;
 }
 
 QString resolveIconPath(const QString &iconValue, const QString &desktopFileDir)
@@ -216,88 +636,338 @@ QString resolveIconPath(const QString &iconValue, const QString &desktopFileDir)
     return findIconInTheme(iconValue);
 }
 
-QString findIconInTheme(const QString &iconName)
+QStringList getIconBaseDirs()
 {
-    QStringList iconDirs;
+    QStringList dirs;
+    dirs.append(QDir::homePath() + "/.local/share/icons");
+    dirs.append(QDir::homePath() + "/.icons");
+    for (const QString &dataDir : getXdgDataDirs()) {
+        dirs.append(dataDir + "/icons");
+    }
+    dirs.append("/usr/share/icons");
+    dirs.append("/usr/local/share/icons");
+    dirs.removeDuplicates();
+    dirs.erase(std::remove_if(dirs.begin(), dirs.end(),
+                              [](const QString &dir) { return !QDir(dir).exists(); }),
+               dirs.end());
 
-    // User icon directories
-    QString homeIcons = QDir::homePath() + "/.local/share/icons";
-    if (QDir(homeIcons).exists()) {
-        iconDirs.append(homeIcons);
+    return dirs;
+}
+
+// Icon theme index, built once by scanning each theme directory a single time
+struct IconThemeIndex {
+    struct Entry {
+        QString path;
+        quint64 rank;
+    };
+
+    // Icon file name without extension -> best candidate
+    QHash<QString, Entry> icons;
+    // Indexed directories with application icons
+    QStringList appDirectories;
+    // Icon base directories and the indexed theme directories in them
+    QStringList themeDirectories;
+    // All directories read, including the above
+    QStringList directories;
+};
+
+struct IconThemeDirectory {
+    int size = 0;
+    bool scalable = false;
+    bool apps = false;
+};
+
+struct IconThemeDescription {
+    QStringList inherits;
+    QStringList directories;
+    QHash<QString, IconThemeDirectory> directoryInfo;
+};
+
+static std::shared_ptr<const IconThemeIndex> s_themeIndex;
+static QMutex s_themeIndexMutex;
+
+// Upper bound of files indexed, to keep the scan bounded on unusual setups
+static const int s_maxIndexedFiles = 500000;
+
+static IconThemeDescription parseIndexTheme(const QString &path)
+{
+    IconThemeDescription desc;
+
+    QFile file(path);
+    if (!file.open(QIODevice::ReadOnly | QIODevice::Text)) {
+        return desc;
     }
 
-    QString homeIconsLegacy = QDir::homePath() + "/.icons";
-    if (QDir(homeIconsLegacy).exists()) {
-        iconDirs.append(homeIconsLegacy);
+    QTextStream in(&file);
+    QString section;
+
+    while (!in.atEnd()) {
+        QString line = in.readLine().trimmed();
+
+        if (line.isEmpty() || line.startsWith('#')) {
+            continue;
+        }
+
+        if (line.startsWith('[') && line.endsWith(']')) {
+            section = line.mid(1, line.size() - 2);
+            continue;
+        }
+
+        int eq = line.indexOf('=');
+        if (eq == -1) {
+            continue;
+        }
+        QString key = line.left(eq).trimmed();
+        QString value = line.mid(eq + 1).trimmed();
+
+        if (section == "Icon Theme") {
+            if (key == "Inherits") {
+                desc.inherits = value.split(',', Qt::SkipEmptyParts);
+            } else if (key == "Directories" || key == "ScaledDirectories") {
+                desc.directories.append(value.split(',', Qt::SkipEmptyParts));
+            }
+        } else if (!section.isEmpty()) {
+            IconThemeDirectory &dir = desc.directoryInfo[section];
+            if (key == "Size") {
+                dir.size = value.toInt();
+            } else if (key == "Type") {
+                dir.scalable = (value == "Scalable");
+            } else if (key == "Context") {
+                dir.apps = (value == "Applications");
+            }
+        }
     }
 
-    // System icon directories
-    iconDirs.append("/usr/share/icons");
-    iconDirs.append("/usr/local/share/icons");
-    iconDirs.append("/usr/share/pixmaps");
+    desc.directories.removeDuplicates();
+    return desc;
+}
 
-    QStringList themes;
+// Derive directory info from paths like "48x48/apps" or "scalable/apps" for
+// themes without an index.theme
+static IconThemeDirectory guessDirectoryInfo(const QString &subdir)
+{
+    IconThemeDirectory dir;
+    for (const QString &part : subdir.split('/')) {
+        if (part == "scalable") {
+            dir.scalable = true;
+        } else if (part == "apps" || part == "applications") {
+            dir.apps = true;
+        } else if (part.contains('x')) {
+            dir.size = part.section('x', 0, 0).toInt();
+        }
+    }
+    return dir;
+}
+
+// Lower is better: base directory, then theme, then application context, then
+// size (scalable first, then larger), then extension (svg, png, xpm)
+static quint64 iconRank(int baseDir, int theme, const IconThemeDirectory &dir, int ext)
+{
+    quint64 sizeRank = dir.scalable ? 0 : 1 + (4096 - qBound(0, dir.size, 4095));
+    return ((((quint64(baseDir) << 8 | quint64(theme)) << 1 | (dir.apps ? 0 : 1))
+             << 13 | sizeRank) << 2) | quint64(ext);
+}
 
-    // Current system icon theme first
-    QString currentTheme = QIcon::themeName();
+static std::shared_ptr<const IconThemeIndex> buildIconThemeIndex()
+{
+    QElapsedTimer timer;
+    timer.start();
+
+    const QStringList baseDirs = getIconBaseDirs();
+
+    // Current system icon theme first, followed by the themes it inherits
+    // from, then common fallback themes
+    QStringList themes;
+    QString currentTheme = themeName();
     if (!currentTheme.isEmpty()) {
         themes.append(currentTheme);
     }
-
-    // Fallback themes
     themes.append({"hicolor", "breeze", "Adwaita", "gnome", "oxygen", "Papirus"});
-    themes.removeDuplicates();
 
-    // Common sizes to try (prefer larger icons)
-    QStringList sizes = {"scalable", "512x512", "256x256", "128x128", "96x96",
-                         "64x64", "48x48", "32x32", "24x24", "16x16"};
-
-    // Common contexts
-    QStringList contexts = {"apps", "applications", "mimetypes", "places", "devices"};
+    QHash<QString, IconThemeDescription> descriptions;
+    for (int i = 0; i < themes.count() && i < 255; ++i) {
+        const QString theme = themes[i];
+        if (descriptions.contains(theme)) {
+            continue;
+        }
 
-    // Common extensions
-    QStringList extensions = {".svg", ".png", ".xpm"};
+        IconThemeDescription desc;
+        for (const QString &baseDir : baseDirs) {
+            QString indexPath = baseDir + "/" + theme + "/index.theme";
+            if (QFileInfo(indexPath).isFile()) {
+                desc = parseIndexTheme(indexPath);
+                break;
+            }
+        }
+        descriptions.insert(theme, desc);
 
-    // Icon name variants (case-insensitive)
-    QStringList iconVariants = {
-        iconName,
-        iconName.toLower(),
-        iconName.left(1).toLower() + iconName.mid(1)
-    };
+        int pos = i + 1;
+        for (const QString &parent : desc.inherits) {
+            if (!themes.contains(parent)) {
+                themes.insert(pos++, parent);
+            }
+        }
+    }
 
-    auto checkPath = [](const QString &path) -> QString {
-        QFileInfo info(path);
-        return info.isFile() ? info.absoluteFilePath() : QString();
+    auto index = std::make_shared<IconThemeIndex>();
+    // Themes being added to or removed from a base directory
+    index->themeDirectories = baseDirs;
+    index->directories = baseDirs;
+    const QStringList extensions = {".svg", ".png", ".xpm"};
+    const QStringList nameFilters = {"*.svg", "*.png", "*.xpm"};
+    int filesScanned = 0;
+    int dirsScanned = 0;
+
+    auto addIcon = [&](const QString &dirPath, const QString &fileName, quint64 rank) {
+        int dot = fileName.lastIndexOf('.');
+        QString name = fileName.left(dot);
+        rank |= quint64(qMax(0, int(extensions.indexOf(fileName.mid(dot).toLower()))));
+
+        auto it = index->icons.find(name);
+        if (it == index->icons.end()) {
+            index->icons.insert(name, {dirPath + "/" + fileName, rank});
+        } else if (rank < it->rank) {
+            *it = {dirPath + "/" + fileName, rank};
+        }
     };
 
-    // Search pattern: iconDir/theme/size/context/iconName.ext
-    for (const QString &iconDir : iconDirs) {
-        for (const QString &theme : themes) {
-            for (const QString &size : sizes) {
-                for (const QString &context : contexts) {
-                    for (const QString &variant : iconVariants) {
-                        for (const QString &ext : extensions) {
-                            QString result = checkPath(QString("%1/%2/%3/%4/%5%6")
-                                .arg(iconDir, theme, size, context, variant, ext));
-                            if (!result.isEmpty()) return result;
-                        }
+    for (int b = 0; b < baseDirs.count() && filesScanned < s_maxIndexedFiles; ++b) {
+        for (int t = 0; t < themes.count() && t < 255 && filesScanned < s_maxIndexedFiles; ++t) {
+            QString themeDir = baseDirs[b] + "/" + themes[t];
+            if (!QDir(themeDir).exists()) {
+                continue;
+            }
+            index->themeDirectories.append(themeDir);
+            index->directories.append(themeDir);
+
+            const IconThemeDescription &desc = descriptions[themes[t]];
+            QStringList subdirs = desc.directories;
+            if (subdirs.isEmpty()) {
+                // No index.theme: assume the common <size>/<context> layout
+                const QStringList sizes = QDir(themeDir).entryList(QDir::Dirs | QDir::NoDotAndDotDot);
+                for (const QString &size : sizes) {
+                    const QStringList contexts = QDir(themeDir + "/" + size)
+                        .entryList(QDir::Dirs | QDir::NoDotAndDotDot);
+                    for (const QString &context : contexts) {
+                        subdirs.append(size + "/" + context);
                     }
                 }
             }
-        }
 
-        // Direct pixmaps check
-        if (iconDir.endsWith("/pixmaps")) {
-            for (const QString &variant : iconVariants) {
-                for (const QString &ext : extensions) {
-                    QString result = checkPath(iconDir + "/" + variant + ext);
-                    if (!result.isEmpty()) return result;
+            for (const QString &subdir : std::as_const(subdirs)) {
+                QString dirPath = themeDir + "/" + subdir;
+                const QStringList files = QDir(dirPath).entryList(nameFilters, QDir::Files);
+                index->directories.append(dirPath);
+                ++dirsScanned;
+
+                IconThemeDirectory info = desc.directoryInfo.contains(subdir)
+                    ? desc.directoryInfo.value(subdir)
+                    : guessDirectoryInfo(subdir);
+                quint64 rank = iconRank(b, t, info, 0);
+
+                for (const QString &fileName : files) {
+                    addIcon(dirPath, fileName, rank);
+                }
+                filesScanned += files.count();
+
+                if (info.apps) {
+                    index->appDirectories.append(dirPath);
                 }
             }
         }
     }
 
-    return QString();
+    // Unthemed icons rank below all themes
+    const QString pixmaps = "/usr/share/pixmaps";
+    const QStringList pixmapFiles = QDir(pixmaps).entryList(nameFilters, QDir::Files);
+    for (const QString &fileName : pixmapFiles) {
+        addIcon(pixmaps, fileName, iconRank(255, 255, IconThemeDirectory(), 0));
+    }
+    filesScanned += pixmapFiles.count();
+    index->appDirectories.append(pixmaps);
+    index->directories.append(pixmaps);
+
+    if (filesScanned >= s_maxIndexedFiles) {
+        qWarning() << "Icon theme index truncated after" << filesScanned << "files";
+    }
+    qDebug() << "Built icon theme index with" << index->icons.count() << "icons from"
+             << filesScanned << "files in" << dirsScanned << "directories in"
+             << timer.elapsed() << "ms";
+
+    return index;
+}
+
+static std::shared_ptr<const IconThemeIndex> iconThemeIndex()
+{
+    QMutexLocker locker(&s_themeIndexMutex);
+    if (!s_themeIndex) {
+        s_themeIndex = buildIconThemeIndex();
+    }
+    return s_themeIndex;
+}
+
+QStringList indexedIconDirectories()
+{
+    QMutexLocker locker(&s_themeIndexMutex);
+    return s_themeIndex ? s_themeIndex->appDirectories : QStringList();
+}
+
+QStringList indexedDesktopDirectories()
+{
+    QMutexLocker locker(&s_desktopIndexMutex);
+    return s_desktopIndex ? s_desktopIndex->directories : QStringList();
+}
+
+QStringList indexedThemeDirectories()
+{
+    QMutexLocker locker(&s_themeIndexMutex);
+    return s_themeIndex ? s_themeIndex->themeDirectories : QStringList();
+}
+
+QStringList indexedDirectories()
+{
+    QStringList dirs;
+    {
+        QMutexLocker locker(&s_desktopIndexMutex);
+        if (s_desktopIndex) {
+            dirs.append(s_desktopIndex->directories);
+        }
+    }
+    {
+        QMutexLocker locker(&s_themeIndexMutex);
+        if (s_themeIndex) {
+            dirs.append(s_themeIndex->directories);
+        }
+    }
+    return dirs;
+}
+
+void clearIconThemeIndex()
+{
+    QMutexLocker locker(&s_themeIndexMutex);
+    s_themeIndex.reset();
+}
+
+QString findIconInTheme(const QString &iconName)
+{
+    std::shared_ptr<const IconThemeIndex> index = iconThemeIndex();
+
+    // Icon name variants (case-insensitive)
+    const QString variants[] = {
+        iconName,
+        iconName.toLower(),
+        iconName.left(1).toLower() + iconName.mid(1)
+    };
+
+    const IconThemeIndex::Entry *best = nullptr;
+    for (const QString &variant : variants) {
+        auto it = index->icons.constFind(variant);
+        if (it != index->icons.constEnd() && (!best || it->rank < best->rank)) {
+            best = &it.value();
+        }
+    }
+
+    return best ? best->path : QString();
 }
 
 } // namespace Internal
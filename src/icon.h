@@ -1,5 +1,6 @@
 #pragma once
 
+#include <optional>
 #include <QString>
 #include <QHash>
 
@@ -14,18 +15,108 @@ namespace IconLookup {
     QString lookup(const QString &appId);
 
     /**
-     * Clear the internal cache.
+     * Resolve and cache the icon path for an application ID, without checking
+     * the cache first, e.g. after a cache miss was already counted.
+     */
+    QString resolveUncached(const QString &appId);
+
+    /**
+     * Return the cached icon path for an application ID, without resolving it.
+     *
+     * @return The cached path (possibly empty if no icon was found), or
+     *         std::nullopt if the app ID hasn't been resolved yet
+     */
+    std::optional<QString> cached(const QString &appId);
+
+    // Like cached(), without counting a cache hit or miss
+    std::optional<QString> peek(const QString &appId);
+
+    struct CacheStats {
+        quint64 hits;
+        quint64 misses;
+        quint64 evictions;
+        int size;
+    };
+
+    /**
+     * Hit/miss counters and size of the cache, which is shared by all threads
+     * and bounded with least recently used eviction.
+     */
+    CacheStats cacheStats();
+
+    /**
+     * Clear the internal cache and the icon theme index.
      * Useful for testing or if icon theme changes at runtime.
      */
     void clearCache();
 
+    /**
+     * Set the system icon theme, which is searched before the fallback themes.
+     * QIcon's theme may only be read on the GUI thread, so it's passed in from
+     * there instead of being read by the threads that resolve icons.
+     *
+     * @return Whether the theme changed, in which case the theme index is
+     *         rebuilt on the next lookup
+     */
+    bool setThemeName(const QString &name);
+    QString themeName();
+
+    /**
+     * Directories whose contents affect icon resolution, to be watched for
+     * changes: applications directories, icon theme directories, and the
+     * indexed application icon directories. Only the directories of the
+     * indexes built so far and of a loaded persistent cache are returned, so
+     * this doesn't touch the file system.
+     */
+    QStringList watchedDirectories();
+
+    /**
+     * Rebuild the indexes affected by changes in the given directories, and
+     * resolve the cached app IDs again.
+     *
+     * @return The app IDs whose icon path changed, mapped to their new path
+     */
+    QHash<QString, QString> invalidate(const QStringList &changedDirs);
+
+    /**
+     * Persist resolved icon paths under $XDG_CACHE_HOME/qml-niri/.
+     * When enabled, a previously saved cache is loaded if none of the
+     * directories read to resolve it, down to the ones holding desktop files
+     * and icons, have been modified since it was saved, so that a warm start
+     * resolves icons without scanning any directories.
+     */
+    void setPersistentCacheEnabled(bool enabled);
+    bool persistentCacheEnabled();
+
+    /**
+     * Write the cache to disk, if it's persistent and has new entries.
+     */
+    void savePersistentCache();
+
 namespace Internal {
+    struct DesktopEntry {
+        QString path;
+        QString icon;
+        QString startupWMClass;
+        bool hidden = false;
+    };
+
     // Internal functions exposed for testing purposes
+    DesktopEntry findDesktopEntry(const QString &appId);
+    DesktopEntry parseDesktopEntry(const QString &desktopFilePath);
+    void clearDesktopEntryIndex();
     QString findDesktopFile(const QString &appId);
     QString parseIconFromDesktopFile(const QString &desktopFilePath);
     QString resolveIconPath(const QString &iconValue, const QString &desktopFileDir);
     QString findIconInTheme(const QString &iconName);
+    QStringList indexedIconDirectories();
+    QStringList indexedDesktopDirectories();
+    QStringList indexedThemeDirectories();
+    // Directories read by the indexes built so far
+    QStringList indexedDirectories();
+    void clearIconThemeIndex();
     QStringList getXdgDataDirs();
+    QStringList getIconBaseDirs();
 }
 
 } // namespace IconLookup
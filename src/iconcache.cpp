@@ -0,0 +1,115 @@
+#include "iconcache.h"
+#include <algorithm>
+
+IconCache::IconCache(int capacity)
+    : m_shardCapacity(std::max(1, capacity / ShardCount))
+{
+}
+
+IconCache::Shard &IconCache::shardFor(const QString &appId) const
+{
+    return m_shards[qHash(appId) % ShardCount];
+}
+
+std::optional<QString> IconCache::get(const QString &appId) const
+{
+    Shard &shard = shardFor(appId);
+    QReadLocker locker(&shard.lock);
+
+    auto it = shard.nodes.find(appId);
+    if (it == shard.nodes.end()) {
+        m_misses.fetch_add(1, std::memory_order_relaxed);
+        return std::nullopt;
+    }
+
+    it->second.lastUsed.store(tick(), std::memory_order_relaxed);
+    m_hits.fetch_add(1, std::memory_order_relaxed);
+    return it->second.path;
+}
+
+std::optional<QString> IconCache::peek(const QString &appId) const
+{
+    Shard &shard = shardFor(appId);
+    QReadLocker locker(&shard.lock);
+
+    auto it = shard.nodes.find(appId);
+    if (it == shard.nodes.end()) {
+        return std::nullopt;
+    }
+    return it->second.path;
+}
+
+void IconCache::insert(const QString &appId, const QString &iconPath)
+{
+    Shard &shard = shardFor(appId);
+    QWriteLocker locker(&shard.lock);
+
+    auto it = shard.nodes.find(appId);
+    if (it != shard.nodes.end()) {
+        it->second.path = iconPath;
+        it->second.lastUsed.store(tick(), std::memory_order_relaxed);
+        return;
+    }
+
+    if (int(shard.nodes.size()) >= m_shardCapacity) {
+        auto lru = std::min_element(shard.nodes.begin(), shard.nodes.end(),
+                                    [](const auto &a, const auto &b) {
+            return a.second.lastUsed.load(std::memory_order_relaxed)
+                < b.second.lastUsed.load(std::memory_order_relaxed);
+        });
+        shard.nodes.erase(lru);
+        m_evictions.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    shard.nodes.emplace(std::piecewise_construct,
+                        std::forward_as_tuple(appId),
+                        std::forward_as_tuple(iconPath, tick()));
+}
+
+void IconCache::insertMissing(const QHash<QString, QString> &entries)
+{
+    for (auto it = entries.constBegin(); it != entries.constEnd(); ++it) {
+        Shard &shard = shardFor(it.key());
+        QWriteLocker locker(&shard.lock);
+
+        if (int(shard.nodes.size()) < m_shardCapacity) {
+            shard.nodes.emplace(std::piecewise_construct,
+                                std::forward_as_tuple(it.key()),
+                                std::forward_as_tuple(it.value(), tick()));
+        }
+    }
+}
+
+void IconCache::clear()
+{
+    for (Shard &shard : m_shards) {
+        QWriteLocker locker(&shard.lock);
+        shard.nodes.clear();
+    }
+}
+
+QHash<QString, QString> IconCache::entries() const
+{
+    QHash<QString, QString> result;
+    for (const Shard &shard : m_shards) {
+        QReadLocker locker(&shard.lock);
+        for (const auto &node : shard.nodes) {
+            result.insert(node.first, node.second.path);
+        }
+    }
+    return result;
+}
+
+IconCache::Stats IconCache::stats() const
+{
+    Stats stats;
+    stats.hits = m_hits.load(std::memory_order_relaxed);
+    stats.misses = m_misses.load(std::memory_order_relaxed);
+    stats.evictions = m_evictions.load(std::memory_order_relaxed);
+
+    for (const Shard &shard : m_shards) {
+        QReadLocker locker(&shard.lock);
+        stats.size += int(shard.nodes.size());
+    }
+    return stats;
+}
@@ -0,0 +1,67 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <optional>
+#include <unordered_map>
+#include <QHash>
+#include <QReadWriteLock>
+#include <QString>
+
+/**
+ * Thread-safe cache of app ID -> icon path mappings.
+ *
+ * Entries are spread over shards by key hash. Reads only take a shared lock
+ * on a single shard and bump the entry's last use with an atomic, so
+ * concurrent lookups don't serialize. Each shard is bounded, and inserting
+ * into a full shard evicts its least recently used entry.
+ */
+class IconCache
+{
+public:
+    struct Stats {
+        quint64 hits = 0;
+        quint64 misses = 0;
+        quint64 evictions = 0;
+        int size = 0;
+    };
+
+    explicit IconCache(int capacity = 4096);
+
+    std::optional<QString> get(const QString &appId) const;
+    // Like get(), without counting a hit or miss or marking the entry as used
+    std::optional<QString> peek(const QString &appId) const;
+    void insert(const QString &appId, const QString &iconPath);
+    // Insert entries that aren't cached yet, without evicting any
+    void insertMissing(const QHash<QString, QString> &entries);
+    void clear();
+
+    QHash<QString, QString> entries() const;
+    Stats stats() const;
+
+private:
+    static const int ShardCount = 16;
+
+    struct Node {
+        explicit Node(const QString &path, quint64 lastUsed)
+            : path(path), lastUsed(lastUsed) {}
+
+        QString path;
+        mutable std::atomic<quint64> lastUsed;
+    };
+
+    struct Shard {
+        mutable QReadWriteLock lock;
+        std::unordered_map<QString, Node> nodes;
+    };
+
+    Shard &shardFor(const QString &appId) const;
+    quint64 tick() const { return m_clock.fetch_add(1, std::memory_order_relaxed); }
+
+    int m_shardCapacity;
+    mutable std::array<Shard, ShardCount> m_shards;
+    mutable std::atomic<quint64> m_clock{0};
+    mutable std::atomic<quint64> m_hits{0};
+    mutable std::atomic<quint64> m_misses{0};
+    std::atomic<quint64> m_evictions{0};
+};
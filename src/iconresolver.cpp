@@ -0,0 +1,206 @@
+#include "iconresolver.h"
+#include "icon.h"
+#include "niristats.h"
+#include <QDebug>
+#include <QEvent>
+#include <QGuiApplication>
+#include <QIcon>
+#include <QWindow>
+
+// Upper bound of watched directories, to stay well within inotify limits
+static const int s_maxWatchedDirectories = 2048;
+
+IconResolver *IconResolver::instance()
+{
+    static IconResolver *s_instance = new IconResolver(QCoreApplication::instance());
+    return s_instance;
+}
+
+IconResolver::IconResolver(QObject *parent)
+    : QObject(parent)
+{
+    // Lookups are bound by file system access, so a couple of threads suffice
+    m_pool.setMaxThreadCount(2);
+
+    m_idleTimer.setSingleShot(true);
+    m_idleTimer.setInterval(2000);
+    QObject::connect(&m_idleTimer, &QTimer::timeout, this, [this] {
+        m_pool.start([] { IconLookup::savePersistentCache(); });
+        updateWatchedDirectories();
+        watchThemeChanges();
+    });
+
+    m_invalidateTimer.setSingleShot(true);
+    m_invalidateTimer.setInterval(500);
+    QObject::connect(&m_invalidateTimer, &QTimer::timeout,
+                     this, &IconResolver::invalidateChangedDirectories);
+
+    QObject::connect(&m_watcher, &QFileSystemWatcher::directoryChanged,
+                     this, &IconResolver::onDirectoryChanged);
+
+    // The theme is read here and on theme changes, as QIcon is not safe to
+    // use from the pool
+    IconLookup::setThemeName(QIcon::themeName());
+    if (qobject_cast<QGuiApplication *>(QCoreApplication::instance())) {
+        QObject::connect(qGuiApp, &QGuiApplication::focusWindowChanged,
+                         this, &IconResolver::watchThemeChanges);
+        watchThemeChanges();
+    }
+
+    // Directories are watched once something was resolved or a persistent
+    // cache was loaded, see updateWatchedDirectories()
+}
+
+IconResolver::~IconResolver()
+{
+    m_pool.clear();
+    m_pool.waitForDone();
+    IconLookup::savePersistentCache();
+}
+
+QString IconResolver::lookup(const QString &appId)
+{
+    if (appId.isEmpty()) {
+        return QString();
+    }
+
+    if (std::optional<QString> path = IconLookup::cached(appId)) {
+        return *path;
+    }
+
+    {
+        QMutexLocker locker(&m_pendingMutex);
+        if (m_pending.contains(appId)) {
+            return QString();
+        }
+        m_pending.insert(appId);
+    }
+
+    m_pool.start([this, appId] {
+        NiriStats *stats = NiriStats::instance();
+        qint64 start = stats->enabled() ? NiriStats::now() : 0;
+
+        // The miss was counted above
+        QString path = IconLookup::resolveUncached(appId);
+        if (start) {
+            stats->recordSpan(NiriStats::IconLookupSpan, start, NiriStats::now());
+        }
+        QMetaObject::invokeMethod(this, [this, appId, path] {
+            {
+                QMutexLocker locker(&m_pendingMutex);
+                m_pending.remove(appId);
+            }
+            m_idleTimer.start();
+            // An invalidation may have stored and announced a newer path
+            // before this was delivered, so announce the cached one
+            emit iconResolved(appId, IconLookup::peek(appId).value_or(path));
+        }, Qt::QueuedConnection);
+    });
+
+    return QString();
+}
+
+bool IconResolver::eventFilter(QObject *watched, QEvent *event)
+{
+    if (event->type() == QEvent::ThemeChange) {
+        updateThemeName();
+    }
+    return QObject::eventFilter(watched, event);
+}
+
+void IconResolver::watchThemeChanges()
+{
+    // Theme changes are sent to every top-level window, so filtering one of
+    // them is enough and keeps the filter off all other events. Bars may
+    // never take focus, so this is also retried once icons were resolved.
+    if (m_themeWindow || !qobject_cast<QGuiApplication *>(QCoreApplication::instance())) {
+        return;
+    }
+
+    const QWindowList windows = QGuiApplication::topLevelWindows();
+    if (!windows.isEmpty()) {
+        m_themeWindow = windows.first();
+        m_themeWindow->installEventFilter(this);
+    }
+}
+
+void IconResolver::updateThemeName()
+{
+    // The theme index was dropped, so resolving the cached app IDs again
+    // announces the icons that changed. Changes are coalesced like directory
+    // changes.
+    if (IconLookup::setThemeName(QIcon::themeName()) && !m_invalidateTimer.isActive()) {
+        m_invalidateTimer.start();
+    }
+}
+
+void IconResolver::onDirectoryChanged(const QString &path)
+{
+    m_changedDirs.insert(path);
+    m_invalidateTimer.start();
+}
+
+void IconResolver::invalidateChangedDirectories()
+{
+    QStringList dirs(m_changedDirs.begin(), m_changedDirs.end());
+    m_changedDirs.clear();
+
+    qDebug() << "Icon directories changed:" << dirs;
+
+    m_pool.start([this, dirs] {
+        QHash<QString, QString> changed = IconLookup::invalidate(dirs);
+        QStringList watched = IconLookup::watchedDirectories();
+
+        QMetaObject::invokeMethod(this, [this, changed, watched] {
+            setWatchedDirectories(watched);
+            for (auto it = changed.constBegin(); it != changed.constEnd(); ++it) {
+                emit iconResolved(it.key(), it.value());
+            }
+            if (!changed.isEmpty()) {
+                m_idleTimer.start();
+            }
+        }, Qt::QueuedConnection);
+    });
+}
+
+void IconResolver::setPersistentCacheEnabled(bool enabled)
+{
+    IconLookup::setPersistentCacheEnabled(enabled);
+    if (enabled) {
+        // Watch the directories the loaded cache depends on
+        updateWatchedDirectories();
+    }
+}
+
+void IconResolver::updateWatchedDirectories()
+{
+    // Only the directories the indexes or a loaded cache already know of,
+    // so this doesn't walk any directories
+    setWatchedDirectories(IconLookup::watchedDirectories());
+}
+
+void IconResolver::setWatchedDirectories(const QStringList &dirs)
+{
+    QStringList wanted = dirs.mid(0, s_maxWatchedDirectories);
+    if (dirs.count() > s_maxWatchedDirectories) {
+        qWarning() << "Watching only" << s_maxWatchedDirectories << "of"
+                   << dirs.count() << "icon directories";
+    }
+
+    QSet<QString> wantedSet(wanted.begin(), wanted.end());
+    const QStringList current = m_watcher.directories();
+
+    QStringList stale;
+    for (const QString &dir : current) {
+        if (!wantedSet.remove(dir)) {
+            stale.append(dir);
+        }
+    }
+
+    if (!stale.isEmpty()) {
+        m_watcher.removePaths(stale);
+    }
+    if (!wantedSet.isEmpty()) {
+        m_watcher.addPaths(QStringList(wantedSet.begin(), wantedSet.end()));
+    }
+}
@@ -0,0 +1,79 @@
+#pragma once
+
+#include <QFileSystemWatcher>
+#include <QMutex>
+#include <QObject>
+#include <QPointer>
+#include <QSet>
+#include <QString>
+#include <QThreadPool>
+#include <QTimer>
+
+class QWindow;
+
+/**
+ * Resolves application icons on a background thread pool.
+ *
+ * Concurrent requests for the same app ID are coalesced into a single lookup.
+ * Results are cached by IconLookup and announced with iconResolved() on the
+ * thread the resolver lives in.
+ *
+ * lookup() can be called from any thread, e.g. by models of Niri instances
+ * in different QML engines.
+ *
+ * The directories icons are resolved from are watched, and when they change,
+ * only the app IDs whose icon changed are announced again.
+ */
+class IconResolver : public QObject
+{
+    Q_OBJECT
+
+public:
+    // Shared resolver, owned by the application object
+    static IconResolver *instance();
+
+    ~IconResolver();
+
+    /**
+     * Return the icon path for an app ID if it's already known. Otherwise
+     * schedule its resolution and return an empty string; iconResolved() is
+     * emitted once it's done.
+     */
+    QString lookup(const QString &appId);
+
+    /**
+     * Enable IconLookup's persistent cache, and watch the directories a
+     * loaded cache depends on.
+     */
+    void setPersistentCacheEnabled(bool enabled);
+
+signals:
+    void iconResolved(const QString &appId, const QString &iconPath);
+
+protected:
+    bool eventFilter(QObject *watched, QEvent *event) override;
+
+private:
+    explicit IconResolver(QObject *parent = nullptr);
+
+    void watchThemeChanges();
+    void updateThemeName();
+    void onDirectoryChanged(const QString &path);
+    void invalidateChangedDirectories();
+    void updateWatchedDirectories();
+    void setWatchedDirectories(const QStringList &dirs);
+
+    QThreadPool m_pool;
+    QMutex m_pendingMutex;
+    QSet<QString> m_pending;
+    // Saves the persistent cache and updates watched directories after a
+    // batch of resolutions
+    QTimer m_idleTimer;
+
+    QFileSystemWatcher m_watcher;
+    QSet<QString> m_changedDirs;
+    // Coalesces bursts of changes, e.g. from package installs
+    QTimer m_invalidateTimer;
+    // Top-level window whose theme change events are filtered
+    QPointer<QWindow> m_themeWindow;
+};
@@ -1,4 +1,7 @@
 #include "ipcclient.h"
+#include "eventstream.h"
+#include "niristats.h"
+#include <QJsonArray>
 #include <QJsonObject>
 #include <QJsonDocument>
 #include <QProcessEnvironment>
@@ -6,27 +9,99 @@
 
 IPCClient::IPCClient(QObject *parent)
     : QObject(parent)
-    , m_eventSocket(new QLocalSocket(this))
+    , m_eventStream(new EventStream)
     , m_requestSocket(new QLocalSocket(this))
+    , m_reconnectTimer(new QTimer(this))
 {
-    QObject::connect(m_eventSocket, &QLocalSocket::readyRead,
-                     this, &IPCClient::onReadyRead);
-    QObject::connect(m_eventSocket, &QLocalSocket::errorOccurred,
-                     this, &IPCClient::onSocketError);
-    QObject::connect(m_eventSocket, &QLocalSocket::disconnected,
-                     this, &IPCClient::disconnected);
+    qRegisterMetaType<NiriEvent>();
+    m_eventStream->setRecorder(&m_recorder);
+    // Create the stats object in this thread, before the event stream uses it
+    NiriStats::instance();
+
+    QObject::connect(m_eventStream, &EventStream::connected,
+                     this, &IPCClient::onEventStreamConnected);
+    QObject::connect(m_eventStream, &EventStream::eventReceived,
+                     this, &IPCClient::dispatchEvent);
+    QObject::connect(m_eventStream, &EventStream::errorOccurred,
+                     this, &IPCClient::errorOccurred);
+    QObject::connect(m_eventStream, &EventStream::disconnected,
+                     this, &IPCClient::handleConnectionLost);
+
+    QObject::connect(m_requestSocket, &QLocalSocket::connected,
+                     this, &IPCClient::updateConnected);
+    QObject::connect(m_requestSocket, &QLocalSocket::readyRead,
+                     this, &IPCClient::onRequestReadyRead);
+    QObject::connect(m_requestSocket, &QLocalSocket::errorOccurred,
+                     this, &IPCClient::onRequestSocketError);
+    QObject::connect(m_requestSocket, &QLocalSocket::disconnected,
+                     this, &IPCClient::handleConnectionLost);
+
+    m_reconnectTimer->setSingleShot(true);
+    QObject::connect(m_reconnectTimer, &QTimer::timeout,
+                     this, &IPCClient::onReconnectTimeout);
 }
 
 IPCClient::~IPCClient()
 {
-    if (m_eventSocket->isOpen()) {
-        m_eventSocket->close();
+    // Callbacks may reference objects that are already being destroyed, so
+    // drop them instead of failing them when the sockets close below.
+    m_pendingRequests.clear();
+    m_state = State::Disconnected;
+    m_reconnectTimer->stop();
+
+    runInEventThread([this] { m_eventStream->close(); });
+    if (m_eventThread) {
+        // The stream has to be destroyed in its own thread
+        QObject::connect(m_eventThread, &QThread::finished,
+                         m_eventStream, &QObject::deleteLater);
+        m_eventThread->quit();
+        m_eventThread->wait();
+    } else {
+        delete m_eventStream;
     }
+
     if (m_requestSocket->isOpen()) {
         m_requestSocket->close();
     }
 }
 
+void IPCClient::runInEventThread(const std::function<void()> &fn)
+{
+    if (m_eventThread && m_eventThread->isRunning()) {
+        QMetaObject::invokeMethod(m_eventStream, fn, Qt::BlockingQueuedConnection);
+    } else {
+        fn();
+    }
+}
+
+void IPCClient::setThreaded(bool threaded)
+{
+    if (threaded == isThreaded()) {
+        return;
+    }
+
+    if (m_state != State::Disconnected) {
+        qWarning() << "Cannot change event stream threading while connected";
+        return;
+    }
+
+    if (threaded) {
+        m_eventThread = new QThread(this);
+        m_eventThread->setObjectName("niri-events");
+        m_eventStream->moveToThread(m_eventThread);
+        m_eventThread->start();
+    } else {
+        // Objects can only be pushed away from their current thread, so the
+        // stream has to move itself back.
+        QThread *target = thread();
+        runInEventThread([this, target] { m_eventStream->moveToThread(target); });
+        m_eventThread->quit();
+        m_eventThread->wait();
+        delete m_eventThread;
+        m_eventThread = nullptr;
+    }
+}
+
 bool IPCClient::connect()
 {
     m_socketPath = QProcessEnvironment::systemEnvironment().value("NIRI_SOCKET");
@@ -36,122 +111,232 @@ bool IPCClient::connect()
         return false;
     }
 
-    qDebug() << "Connecting to niri socket for events:" << m_socketPath;
-    m_eventSocket->connectToServer(m_socketPath);
+    if (m_state != State::Disconnected) {
+        return true;
+    }
+
+    m_reconnectTimer->stop();
+    m_reconnectDelay = MinReconnectDelay;
+    startConnecting();
+    return true;
+}
 
-    if (!m_eventSocket->waitForConnected(1000)) {
-        emit errorOccurred("Failed to connect event socket: " + m_eventSocket->errorString());
-        return false;
+void IPCClient::setAutoReconnect(bool enabled)
+{
+    m_autoReconnect = enabled;
+    if (!enabled) {
+        m_reconnectTimer->stop();
+    }
+}
+
+void IPCClient::startConnecting()
+{
+    m_state = State::Connecting;
+    m_eventStreamConnected = false;
+
+    qDebug() << "Connecting to niri socket:" << m_socketPath;
+    runInEventThread([this] { m_eventStream->open(m_socketPath); });
+
+    // The event socket may already have failed synchronously
+    if (m_state == State::Connecting) {
+        m_requestSocket->connectToServer(m_socketPath);
+    }
+}
+
+void IPCClient::onEventStreamConnected()
+{
+    if (m_state != State::Connecting) {
+        return;
+    }
+
+    m_eventStreamConnected = true;
+    updateConnected();
+}
+
+void IPCClient::updateConnected()
+{
+    if (m_state != State::Connecting || !m_eventStreamConnected ||
+        m_requestSocket->state() != QLocalSocket::ConnectedState) {
+        return;
     }
 
-    qDebug() << "Connecting to niri socket for requests:" << m_socketPath;
-    m_requestSocket->connectToServer(m_socketPath);
+    m_state = State::Connected;
+    m_reconnectDelay = MinReconnectDelay;
+    emit connected();
+}
 
-    if (!m_requestSocket->waitForConnected(1000)) {
+void IPCClient::onRequestSocketError()
+{
+    if (m_state == State::Connecting &&
+        m_requestSocket->state() == QLocalSocket::UnconnectedState) {
         emit errorOccurred("Failed to connect request socket: " + m_requestSocket->errorString());
-        m_eventSocket->close();
-        return false;
+        handleConnectionLost();
     }
+}
 
-    qDebug() << "Listening to niri event stream ...";
-    QByteArray data = "\"EventStream\"\n";
-    qint64 written = m_eventSocket->write(data);
-    if (written != data.size()) {
-        emit errorOccurred("Failed to write event stream request");
-        return false;
+void IPCClient::handleConnectionLost()
+{
+    // Closing the sockets below reports back here, as may a stream closed
+    // by an earlier attempt in threaded mode.
+    if (m_state == State::Disconnected) {
+        return;
     }
-    m_eventSocket->flush();
 
-    emit connected();
-    return true;
+    bool wasConnected = m_state == State::Connected;
+    m_state = State::Disconnected;
+    m_eventStreamConnected = false;
+
+    runInEventThread([this] { m_eventStream->close(); });
+    m_requestSocket->abort();
+    m_requestFramer.clear();
+    failPendingRequests("Disconnected from niri");
+
+    if (wasConnected) {
+        emit disconnected();
+    }
+
+    // The handlers above may have reconnected or disabled reconnection
+    if (m_state != State::Disconnected || !m_autoReconnect) {
+        return;
+    }
+
+    qDebug() << "Reconnecting to niri in" << m_reconnectDelay << "ms";
+    m_reconnectTimer->start(m_reconnectDelay);
+    m_reconnectDelay = qMin(m_reconnectDelay * 2, MaxReconnectDelay);
+}
+
+void IPCClient::onReconnectTimeout()
+{
+    if (m_state == State::Disconnected) {
+        startConnecting();
+    }
+}
+
+bool IPCClient::startRecording(const QString &path)
+{
+    return m_recorder.start(path);
+}
+
+void IPCClient::stopRecording()
+{
+    m_recorder.stop();
+}
+
+void IPCClient::subscribe(NiriEvent::Type type, EventHandler handler)
+{
+    m_eventHandlers[type].append(std::move(handler));
+}
+
+void IPCClient::dispatchEvent(const NiriEvent &event)
+{
+    emit eventReceived(event.raw);
+
+    NiriStats *stats = NiriStats::instance();
+    qint64 start = stats->enabled() ? NiriStats::now() : 0;
+
+    for (const EventHandler &handler : m_eventHandlers[event.type]) {
+        handler(event);
+    }
+
+    if (start) {
+        stats->recordHandler(event.type, start, NiriStats::now());
+    }
 }
 
-bool IPCClient::isConnected() const
+static QByteArray serializeRequest(const QJsonValue &request)
 {
-    return m_eventSocket && m_eventSocket->state() == QLocalSocket::ConnectedState &&
-           m_requestSocket && m_requestSocket->state() == QLocalSocket::ConnectedState;
+    // QJsonDocument only holds objects and arrays, so wrap the request in an
+    // array to also support unit requests such as "Outputs", then strip it.
+    QByteArray json = QJsonDocument(QJsonArray{request}).toJson(QJsonDocument::Compact);
+    return json.mid(1, json.size() - 2) + "\n";
 }
 
-bool IPCClient::sendRequest(const QJsonObject &request)
+quint64 IPCClient::sendRequest(const QJsonValue &request, ReplyCallback callback)
 {
     if (!m_requestSocket || m_requestSocket->state() != QLocalSocket::ConnectedState) {
         qWarning() << "Request socket not connected";
-        return false;
+        return 0;
     }
 
-    QJsonDocument doc(request);
-    QByteArray data = doc.toJson(QJsonDocument::Compact) + "\n";
+    QByteArray data = serializeRequest(request);
 
     qDebug() << "Sending request:" << data;
 
     qint64 written = m_requestSocket->write(data);
     if (written != data.size()) {
         emit errorOccurred("Failed to write request");
-        return false;
+        return 0;
     }
 
     m_requestSocket->flush();
 
-    // Wait for and read the response (blocking, but should be fast)
-    if (m_requestSocket->waitForReadyRead(1000)) {
-        QByteArray response = m_requestSocket->readLine();
-        qDebug() << "Response:" << response;
+    // niri replies to requests on a connection in order, so the reply to this
+    // request is the one after the replies to all requests already in flight.
+    quint64 id = m_nextRequestId++;
+    qint64 sentAt = NiriStats::instance()->enabled() ? NiriStats::now() : 0;
+    m_pendingRequests.enqueue({id, std::move(callback), sentAt});
+
+    return id;
+}
 
-        QJsonParseError parseError;
-        QJsonDocument responseDoc = QJsonDocument::fromJson(response, &parseError);
+void IPCClient::onRequestReadyRead()
+{
+    m_requestFramer.append(m_requestSocket->readAll(), [this](const QByteArray &line) {
+        handleReplyLine(line);
+    });
+}
 
-        if (parseError.error != QJsonParseError::NoError) {
-            qWarning() << "Failed to parse response:" << parseError.errorString();
-            return false;
-        }
+void IPCClient::handleReplyLine(const QByteArray &line)
+{
+    qDebug() << "Response:" << line;
 
-        QJsonObject responseObj = responseDoc.object();
-        if (responseObj.contains("Err")) {
-            qWarning() << "Request error:" << responseObj["Err"].toString();
-            return false;
-        }
+    QJsonParseError parseError;
+    QJsonDocument doc = QJsonDocument::fromJson(line, &parseError);
+
+    if (parseError.error != QJsonParseError::NoError || !doc.isObject()) {
+        qWarning() << "Failed to parse response:" << parseError.errorString();
+        handleReply(QJsonObject{{"Err", "Failed to parse response: " + parseError.errorString()}});
+        return;
     }
 
-    return true;
+    handleReply(doc.object());
 }
 
-void IPCClient::onReadyRead()
+void IPCClient::handleReply(const QJsonObject &reply)
 {
-    m_readBuffer.append(m_eventSocket->readAll());
-
-    // Process complete lines (events are newline-delimited)
-    int newlinePos;
-    while ((newlinePos = m_readBuffer.indexOf('\n')) != -1) {
-        QByteArray line = m_readBuffer.left(newlinePos);
-        m_readBuffer.remove(0, newlinePos + 1);
-
-        QJsonParseError parseError;
-        QJsonDocument doc = QJsonDocument::fromJson(line, &parseError);
+    if (m_pendingRequests.isEmpty()) {
+        qWarning() << "Received reply without a pending request:" << reply;
+        return;
+    }
 
-        if (parseError.error != QJsonParseError::NoError) {
-            qWarning() << "JSON parse error:" << parseError.errorString();
-            continue;
-        }
+    PendingRequest pending = m_pendingRequests.dequeue();
 
-        if (doc.isObject()) {
-            QJsonObject obj = doc.object();
+    if (pending.sentAt) {
+        NiriStats::instance()->recordSpan(NiriStats::RequestSpan, pending.sentAt, NiriStats::now());
+    }
 
-            // First response is the Reply to EventStream request
-            if (obj.contains("Ok") || obj.contains("Err")) {
-                if (obj.contains("Err")) {
-                    emit errorOccurred("Event stream request failed: " +
-                                      obj["Err"].toString());
-                }
-                continue;
-            }
+    if (reply.contains("Err")) {
+        qWarning() << "Request error:" << reply["Err"].toString();
+    }
 
-            // Subsequent messages are Events
-            emit eventReceived(obj);
-        }
+    if (pending.callback) {
+        pending.callback(reply);
     }
+    emit replyReceived(pending.id, reply);
 }
 
-void IPCClient::onSocketError()
+void IPCClient::failPendingRequests(const QString &error)
 {
-    emit errorOccurred(m_eventSocket->errorString());
+    // Take the queue first, as callbacks may send new requests.
+    QQueue<PendingRequest> pending;
+    pending.swap(m_pendingRequests);
+
+    QJsonObject reply{{"Err", error}};
+    while (!pending.isEmpty()) {
+        PendingRequest request = pending.dequeue();
+        if (request.callback) {
+            request.callback(reply);
+        }
+        emit replyReceived(request.id, reply);
+    }
 }
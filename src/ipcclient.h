@@ -1,35 +1,140 @@
 #pragma once
 
+#include <array>
+#include <functional>
 #include <QObject>
 #include <QLocalSocket>
-#include <QSocketNotifier>
+#include <QQueue>
+#include <QThread>
+#include <QTimer>
 #include <QJsonDocument>
+#include <QJsonObject>
+#include "events.h"
+#include "lineframer.h"
+#include "tracerecorder.h"
+
+class EventStream;
 
 class IPCClient : public QObject
 {
     Q_OBJECT
 
 public:
+    using ReplyCallback = std::function<void(const QJsonObject &reply)>;
+    using EventHandler = std::function<void(const NiriEvent &event)>;
+
     explicit IPCClient(QObject *parent = nullptr);
     ~IPCClient();
 
+    /**
+     * Start connecting both sockets without blocking. connected() is emitted
+     * once the event stream and request sockets are up.
+     *
+     * @return false if NIRI_SOCKET is not set
+     */
     bool connect();
-    bool isConnected() const;
-    bool sendRequest(const QJsonObject &request);
+    bool isConnected() const { return m_state == State::Connected; }
+
+    /**
+     * Reconnect with exponential backoff when the connection is lost or the
+     * connection attempt fails. niri sends fresh WorkspacesChanged and
+     * WindowsChanged snapshots on the new event stream, which the models
+     * reconcile against their current contents. Enabled by default.
+     */
+    void setAutoReconnect(bool enabled);
+    bool autoReconnect() const { return m_autoReconnect; }
+
+    /**
+     * Read and parse the event stream on a dedicated worker thread instead of
+     * the thread this client lives on. Parsed events are still delivered on
+     * this client's thread. Must be set before connect().
+     */
+    void setThreaded(bool threaded);
+    bool isThreaded() const { return m_eventThread != nullptr; }
+
+    /**
+     * Queue a request on the request socket without waiting for the reply.
+     * Replies are matched to in-flight requests in FIFO order as they arrive,
+     * so several requests can be pipelined in one round trip.
+     *
+     * @param request The request, e.g. "Outputs" or {"Action": {...}}
+     * @param callback Optional callback invoked with the reply object
+     *                 ({"Ok": ...} or {"Err": ...})
+     * @return Request id passed to replyReceived(), or 0 if it wasn't sent
+     */
+    quint64 sendRequest(const QJsonValue &request, ReplyCallback callback = {});
+
+    /**
+     * Record the raw event stream to a trace file, with monotonic timestamps
+     * in microseconds, until stopRecording(). Recording can be started and
+     * stopped at any time, including while connected.
+     */
+    bool startRecording(const QString &path);
+    void stopRecording();
+    bool isRecording() const { return m_recorder.isRecording(); }
+
+    /**
+     * Register a handler for one event type. Each decoded event is routed
+     * only to the handlers of its type, on this client's thread.
+     */
+    void subscribe(NiriEvent::Type type, EventHandler handler);
 
 signals:
     void connected();
     void disconnected();
     void errorOccurred(const QString &error);
     void eventReceived(const QJsonObject &event);
+    void replyReceived(quint64 requestId, const QJsonObject &reply);
 
 private slots:
-    void onReadyRead();
-    void onSocketError();
+    void dispatchEvent(const NiriEvent &event);
+    void onEventStreamConnected();
+    void onRequestReadyRead();
+    void onRequestSocketError();
+    void onReconnectTimeout();
 
 private:
-    QLocalSocket *m_eventSocket = nullptr;
+    enum class State {
+        Disconnected,
+        Connecting,
+        Connected
+    };
+
+    // Reconnect delay bounds, in milliseconds
+    static constexpr int MinReconnectDelay = 250;
+    static constexpr int MaxReconnectDelay = 30000;
+
+    struct PendingRequest {
+        quint64 id;
+        ReplyCallback callback;
+        // Send time for NiriStats, 0 if stats were disabled
+        qint64 sentAt;
+    };
+
+    void handleReplyLine(const QByteArray &line);
+    void handleReply(const QJsonObject &reply);
+    void failPendingRequests(const QString &error);
+
+    void startConnecting();
+    void updateConnected();
+    void handleConnectionLost();
+
+    // Invoke fn in the event stream's thread and wait for it to finish
+    void runInEventThread(const std::function<void()> &fn);
+
+    EventStream *m_eventStream = nullptr;
+    QThread *m_eventThread = nullptr;
+    TraceRecorder m_recorder;
+    std::array<QList<EventHandler>, NiriEvent::TypeCount> m_eventHandlers;
     QLocalSocket *m_requestSocket = nullptr;
-    QByteArray m_readBuffer;
+    LineFramer m_requestFramer;
+    QQueue<PendingRequest> m_pendingRequests;
+    quint64 m_nextRequestId = 1;
     QString m_socketPath;
+
+    State m_state = State::Disconnected;
+    bool m_eventStreamConnected = false;
+    bool m_autoReconnect = true;
+    QTimer *m_reconnectTimer = nullptr;
+    int m_reconnectDelay = MinReconnectDelay;
 };
@@ -0,0 +1,74 @@
+#pragma once
+
+#include <cstring>
+#include <QByteArray>
+
+/**
+ * Splits a byte stream into newline-delimited lines.
+ *
+ * Complete lines are handed out as views into the internal buffer, and the
+ * consumed prefix is dropped once per append() instead of once per line, so
+ * framing a read that contains many lines is linear in its size.
+ */
+class LineFramer
+{
+public:
+    /**
+     * Append data and call fn(const QByteArray &line) for every complete line,
+     * without the trailing newline.
+     * The line is a non-owning view that is only valid during the call.
+     */
+    template<typename Fn>
+    void append(const QByteArray &data, Fn &&fn)
+    {
+        // The pending partial line is known not to contain a newline
+        qsizetype searchFrom = m_buffer.size();
+
+        if (m_buffer.isEmpty()) {
+            m_buffer = data;
+        } else {
+            m_buffer.append(data);
+        }
+
+        // Iterate over a shared copy that keeps the data alive even if fn
+        // ends up calling clear(), which also drops the remaining lines
+        const QByteArray buffer = m_buffer;
+        const quint64 generation = m_generation;
+        const char *begin = buffer.constData();
+        const qsizetype size = buffer.size();
+        qsizetype offset = 0;
+
+        while (searchFrom < size) {
+            const void *newline = std::memchr(begin + searchFrom, '\n', size - searchFrom);
+            if (!newline) {
+                break;
+            }
+
+            qsizetype end = static_cast<const char *>(newline) - begin;
+            fn(QByteArray::fromRawData(begin + offset, end - offset));
+            if (m_generation != generation) {
+                return;
+            }
+            offset = end + 1;
+            searchFrom = offset;
+        }
+
+        // Compact once, keeping only the trailing partial line
+        if (offset > 0) {
+            m_buffer = offset == size ? QByteArray() : buffer.mid(offset);
+        }
+    }
+
+    void clear()
+    {
+        m_buffer.clear();
+        ++m_generation;
+    }
+
+    qsizetype pendingSize() const { return m_buffer.size(); }
+
+private:
+    QByteArray m_buffer;
+    // Bumped by clear(), so that append() notices it from within fn
+    quint64 m_generation = 0;
+};
@@ -1,12 +1,20 @@
 #include "niri.h"
+#include "icon.h"
+#include "iconresolver.h"
+#include "stringpool.h"
 #include <QDebug>
+#include <QJSEngine>
+#include <QQmlEngine>
 #include <QJsonObject>
+#include <QUrl>
 
 Niri::Niri(QObject *parent)
     : QObject(parent)
     , m_ipcClient(new IPCClient(this))
     , m_workspaceModel(new WorkspaceModel(this))
     , m_windowModel(new WindowModel(this))
+    , m_outputModel(new OutputModel(this))
+    , m_appGroupModel(new AppGroupModel(m_windowModel, this))
 {
     // Wire up IPC client signals
     QObject::connect(m_ipcClient, &IPCClient::connected,
@@ -18,13 +26,37 @@ Niri::Niri(QObject *parent)
     QObject::connect(m_ipcClient, &IPCClient::eventReceived,
                      this, &Niri::rawEventReceived);
 
-    // Wire events to workspace model
-    QObject::connect(m_ipcClient, &IPCClient::eventReceived,
-                     m_workspaceModel, &WorkspaceModel::handleEvent);
+    // Route decoded events to the models that handle them
+    for (NiriEvent::Type type : WorkspaceModel::handledEvents()) {
+        m_ipcClient->subscribe(type, [this](const NiriEvent &event) {
+            m_workspaceModel->handleEvent(event);
+        });
+    }
+    for (NiriEvent::Type type : WindowModel::handledEvents()) {
+        m_ipcClient->subscribe(type, [this](const NiriEvent &event) {
+            m_windowModel->handleEvent(event);
+        });
+    }
 
-    // Wire events to window model
-    QObject::connect(m_ipcClient, &IPCClient::eventReceived,
-                     m_windowModel, &WindowModel::handleEvent);
+    // niri has no output events, so outputs are requested when the config
+    // is reloaded or the outputs in the workspace snapshot change, including
+    // the first snapshot after (re)connecting.
+    QObject::connect(m_ipcClient, &IPCClient::connected, this, [this] {
+        m_workspaceOutputKeys.clear();
+    });
+    for (NiriEvent::Type type : {NiriEvent::WorkspacesChanged, NiriEvent::WorkspaceActivated,
+                                 NiriEvent::ConfigLoaded}) {
+        m_ipcClient->subscribe(type, [this](const NiriEvent &event) {
+            updateOutputs(event);
+        });
+    }
+
+    m_ipcClient->subscribe(NiriEvent::WorkspacesChanged, [this](const NiriEvent &) {
+        pruneViews();
+    });
+
+    // Sorting windows by position needs their workspaces
+    m_windowModel->setWorkspaceModel(m_workspaceModel);
 
     // Forward focused window changes
     QObject::connect(m_windowModel, &WindowModel::focusedWindowChanged,
@@ -45,6 +77,112 @@ bool Niri::isConnected() const
     return m_ipcClient->isConnected();
 }
 
+void Niri::setThreadedEvents(bool threaded)
+{
+    if (threadedEvents() == threaded) {
+        return;
+    }
+
+    m_ipcClient->setThreaded(threaded);
+    if (threadedEvents() == threaded) {
+        emit threadedEventsChanged();
+    }
+}
+
+void Niri::setAutoReconnect(bool enabled)
+{
+    if (autoReconnect() == enabled) {
+        return;
+    }
+
+    m_ipcClient->setAutoReconnect(enabled);
+    emit autoReconnectChanged();
+}
+
+void Niri::updateOutputs(const NiriEvent &event)
+{
+    if (event.type == NiriEvent::ConfigLoaded) {
+        refreshOutputs();
+        return;
+    }
+
+    if (event.type == NiriEvent::WorkspacesChanged) {
+        QSet<int> keys = m_workspaceModel->outputKeys();
+        if (keys != m_workspaceOutputKeys) {
+            m_workspaceOutputKeys = keys;
+            refreshOutputs();
+        }
+    }
+
+    m_outputModel->setFocusedOutput(m_workspaceModel->focusedOutputKey());
+}
+
+void Niri::refreshOutputs()
+{
+    // Only one request in flight, another one follows if needed
+    if (m_outputsRequested) {
+        m_outputsStale = true;
+        return;
+    }
+
+    m_outputsRequested = m_ipcClient->sendRequest("Outputs", [this](const QJsonObject &reply) {
+        m_outputsRequested = false;
+
+        if (reply.contains("Ok")) {
+            const QJsonObject ok = reply["Ok"].toObject();
+            m_outputModel->handleOutputs(ok["Outputs"].toObject());
+            m_outputModel->setFocusedOutput(m_workspaceModel->focusedOutputKey());
+        }
+
+        if (m_outputsStale) {
+            m_outputsStale = false;
+            refreshOutputs();
+        }
+    }) != 0;
+}
+
+FilterModel* Niri::workspacesForOutput(const QString &output)
+{
+    int key = StringPool::key(output);
+
+    QPointer<FilterModel> &model = m_workspacesForOutput[key];
+    if (!model) {
+        model = createView(m_workspaceModel, WorkspaceModel::OutputKeyRole, key);
+    }
+    return model;
+}
+
+FilterModel* Niri::windowsForWorkspace(quint64 workspaceId)
+{
+    QPointer<FilterModel> &model = m_windowsForWorkspace[workspaceId];
+    if (!model) {
+        model = createView(m_windowModel, WindowModel::WorkspaceIdRole,
+                           QVariant::fromValue(workspaceId));
+    }
+    return model;
+}
+
+FilterModel* Niri::createView(QAbstractItemModel *source, int role, const QVariant &value)
+{
+    // Owned by QML, which destroys views once nothing uses them. They have
+    // no parent, as the engine doesn't collect objects that have one.
+    auto *model = new FilterModel(source, role, value);
+    QQmlEngine::setObjectOwnership(model, QQmlEngine::JavaScriptOwnership);
+    return model;
+}
+
+void Niri::pruneViews()
+{
+    // Views of workspaces and outputs that are gone are collected by QML
+    // once unused, so only their cache entries pile up
+    for (auto it = m_workspacesForOutput.begin(); it != m_workspacesForOutput.end();) {
+        it = it.value().isNull() ? m_workspacesForOutput.erase(it) : std::next(it);
+    }
+    for (auto it = m_windowsForWorkspace.begin(); it != m_windowsForWorkspace.end();) {
+        it = it.value().isNull() ? m_windowsForWorkspace.erase(it) : std::next(it);
+    }
+}
+
 void Niri::focusWorkspace(int index)
 {
     QJsonObject reference;
@@ -86,6 +224,21 @@ void Niri::focusWindow(quint64 id)
     sendAction(action);
 }
 
+bool Niri::persistentIconCache() const
+{
+    return IconLookup::persistentCacheEnabled();
+}
+
+void Niri::setPersistentIconCache(bool enabled)
+{
+    if (persistentIconCache() == enabled) {
+        return;
+    }
+
+    IconResolver::instance()->setPersistentCacheEnabled(enabled);
+    emit persistentIconCacheChanged();
+}
+
 Window* Niri::focusedWindow() const
 {
     return m_windowModel->focusedWindow();
@@ -111,6 +264,52 @@ void Niri::closeWindowOrFocused(quint64 id)
     sendAction(action);
 }
 
+bool Niri::startRecording(const QString &path)
+{
+    QString filePath = path.startsWith("file:") ? QUrl(path).toLocalFile() : path;
+
+    bool wasRecording = recording();
+    bool started = m_ipcClient->startRecording(filePath);
+    if (started != wasRecording) {
+        emit recordingChanged();
+    }
+    return started;
+}
+
+void Niri::stopRecording()
+{
+    if (!recording()) {
+        return;
+    }
+
+    m_ipcClient->stopRecording();
+    emit recordingChanged();
+}
+
+quint64 Niri::sendRequest(const QJsonValue &request, const QJSValue &callback)
+{
+    if (!isConnected()) {
+        qWarning() << "Cannot send request: not connected to niri";
+        return 0;
+    }
+
+    if (!callback.isCallable()) {
+        return m_ipcClient->sendRequest(request);
+    }
+
+    return m_ipcClient->sendRequest(request, [this, callback](const QJsonObject &reply) {
+        QJSEngine *engine = qjsEngine(this);
+        if (!engine) {
+            return;
+        }
+
+        QJSValue result = callback.call({engine->toScriptValue(reply)});
+        if (result.isError()) {
+            qWarning() << "Request callback failed:" << result.toString();
+        }
+    });
+}
+
 void Niri::sendAction(const QJsonObject &action)
 {
     if (!isConnected()) {
@@ -1,7 +1,13 @@
 #pragma once
 
+#include <QJSValue>
 #include <QObject>
+#include <QPointer>
+#include "appgroupmodel.h"
+#include "filtermodel.h"
 #include "ipcclient.h"
+#include "niristats.h"
+#include "outputmodel.h"
 #include "workspacemodel.h"
 #include "windowmodel.h"
 
@@ -10,7 +16,14 @@ class Niri : public QObject
     Q_OBJECT
     Q_PROPERTY(WorkspaceModel* workspaces READ workspaces CONSTANT)
     Q_PROPERTY(WindowModel* windows READ windows CONSTANT)
+    Q_PROPERTY(OutputModel* outputs READ outputs CONSTANT)
+    Q_PROPERTY(AppGroupModel* appGroups READ appGroups CONSTANT)
     Q_PROPERTY(Window* focusedWindow READ focusedWindow NOTIFY focusedWindowChanged)
+    Q_PROPERTY(bool threadedEvents READ threadedEvents WRITE setThreadedEvents NOTIFY threadedEventsChanged)
+    Q_PROPERTY(bool autoReconnect READ autoReconnect WRITE setAutoReconnect NOTIFY autoReconnectChanged)
+    Q_PROPERTY(bool recording READ recording NOTIFY recordingChanged)
+    Q_PROPERTY(NiriStats* stats READ stats CONSTANT)
+    Q_PROPERTY(bool persistentIconCache READ persistentIconCache WRITE setPersistentIconCache NOTIFY persistentIconCacheChanged)
 
 public:
     explicit Niri(QObject *parent = nullptr);
@@ -18,11 +31,35 @@ public:
 
     WorkspaceModel* workspaces() const { return m_workspaceModel; }
     WindowModel* windows() const { return m_windowModel; }
+    OutputModel* outputs() const { return m_outputModel; }
+    AppGroupModel* appGroups() const { return m_appGroupModel; }
     Window* focusedWindow() const;
 
+    bool threadedEvents() const { return m_ipcClient->isThreaded(); }
+    void setThreadedEvents(bool threaded);
+
+    bool autoReconnect() const { return m_ipcClient->autoReconnect(); }
+    void setAutoReconnect(bool enabled);
+
+    bool persistentIconCache() const;
+    void setPersistentIconCache(bool enabled);
+
+    bool recording() const { return m_ipcClient->isRecording(); }
+
+    // Shared by all Niri instances
+    NiriStats* stats() const { return NiriStats::instance(); }
+
     Q_INVOKABLE bool connect();
     Q_INVOKABLE bool isConnected() const;
 
+    /**
+     * Filtered views of the workspaces on one output and the windows on one
+     * workspace. They are updated incrementally and shared between callers,
+     * and owned by QML, which destroys them once they are no longer used.
+     */
+    Q_INVOKABLE FilterModel* workspacesForOutput(const QString &output);
+    Q_INVOKABLE FilterModel* windowsForWorkspace(quint64 workspaceId);
+
     Q_INVOKABLE void focusWorkspace(int index);
     Q_INVOKABLE void focusWorkspaceById(quint64 id);
     Q_INVOKABLE void focusWorkspaceByName(const QString &name);
@@ -31,17 +68,46 @@ public:
     Q_INVOKABLE void closeWindow(quint64 id);
     Q_INVOKABLE void closeWindowOrFocused(quint64 id = 0);
 
+    /**
+     * Record the raw event stream to a trace file that the benchmark's
+     * niri-replay server can play back. Accepts a path or a file:// URL.
+     */
+    Q_INVOKABLE bool startRecording(const QString &path);
+    Q_INVOKABLE void stopRecording();
+
+    Q_INVOKABLE quint64 sendRequest(const QJsonValue &request,
+                                    const QJSValue &callback = QJSValue());
+
 signals:
     void connected();
     void disconnected();
     void errorOccurred(const QString &error);
     void rawEventReceived(const QJsonObject &event);
     void focusedWindowChanged();
+    void threadedEventsChanged();
+    void autoReconnectChanged();
+    void persistentIconCacheChanged();
+    void recordingChanged();
 
 private:
     void sendAction(const QJsonObject &action);
+    void updateOutputs(const NiriEvent &event);
+    void refreshOutputs();
+    FilterModel* createView(QAbstractItemModel *source, int role, const QVariant &value);
+    void pruneViews();
 
     IPCClient *m_ipcClient = nullptr;
     WorkspaceModel *m_workspaceModel = nullptr;
     WindowModel *m_windowModel = nullptr;
+    OutputModel *m_outputModel = nullptr;
+    AppGroupModel *m_appGroupModel = nullptr;
+
+    // Outputs with workspaces as of the last snapshot, to detect hotplugs
+    QSet<int> m_workspaceOutputKeys;
+    bool m_outputsRequested = false;
+    bool m_outputsStale = false;
+
+    // Filtered views, by output key and workspace id
+    QHash<int, QPointer<FilterModel>> m_workspacesForOutput;
+    QHash<quint64, QPointer<FilterModel>> m_windowsForWorkspace;
 };
@@ -0,0 +1,253 @@
+#include "niristats.h"
+#include "icon.h"
+#include <chrono>
+#include <QCoreApplication>
+#include <QDebug>
+#include <QFile>
+#include <QThread>
+
+// Upper bound of buffered trace spans, about 40 MB
+static const int s_maxTraceSpans = 1000000;
+
+void Log2Histogram::add(quint64 value)
+{
+    int bucket = value == 0 ? 0 : 64 - qCountLeadingZeroBits(value);
+    m_buckets[qMin(bucket, BucketCount - 1)].fetch_add(1, std::memory_order_relaxed);
+    m_count.fetch_add(1, std::memory_order_relaxed);
+    m_sum.fetch_add(value, std::memory_order_relaxed);
+
+    quint64 max = m_max.load(std::memory_order_relaxed);
+    while (value > max && !m_max.compare_exchange_weak(max, value, std::memory_order_relaxed)) {
+    }
+}
+
+void Log2Histogram::reset()
+{
+    for (std::atomic<quint64> &bucket : m_buckets) {
+        bucket.store(0, std::memory_order_relaxed);
+    }
+    m_count.store(0, std::memory_order_relaxed);
+    m_sum.store(0, std::memory_order_relaxed);
+    m_max.store(0, std::memory_order_relaxed);
+}
+
+quint64 Log2Histogram::percentile(double fraction) const
+{
+    quint64 total = count();
+    if (total == 0) {
+        return 0;
+    }
+
+    quint64 target = qMax<quint64>(1, quint64(fraction * total + 0.5));
+    quint64 seen = 0;
+    for (int bucket = 0; bucket < BucketCount; ++bucket) {
+        seen += m_buckets[bucket].load(std::memory_order_relaxed);
+        if (seen >= target) {
+            quint64 upper = bucket == 0 ? 0 : (quint64(1) << bucket) - 1;
+            return qMin(upper, m_max.load(std::memory_order_relaxed));
+        }
+    }
+    return m_max.load(std::memory_order_relaxed);
+}
+
+QVariantMap Log2Histogram::toVariantMap() const
+{
+    quint64 total = count();
+    quint64 sum = m_sum.load(std::memory_order_relaxed);
+
+    // Trailing empty buckets are left out
+    QVariantList buckets;
+    int last = BucketCount - 1;
+    while (last >= 0 && m_buckets[last].load(std::memory_order_relaxed) == 0) {
+        --last;
+    }
+    for (int bucket = 0; bucket <= last; ++bucket) {
+        buckets.append(m_buckets[bucket].load(std::memory_order_relaxed));
+    }
+
+    return {
+        {"count", total},
+        {"sum", sum},
+        {"mean", total ? double(sum) / total : 0.0},
+        {"max", m_max.load(std::memory_order_relaxed)},
+        {"p50", percentile(0.5)},
+        {"p90", percentile(0.9)},
+        {"p99", percentile(0.99)},
+        {"buckets", buckets},
+    };
+}
+
+NiriStats *NiriStats::instance()
+{
+    static NiriStats *s_instance = new NiriStats(QCoreApplication::instance());
+    return s_instance;
+}
+
+NiriStats::NiriStats(QObject *parent)
+    : QObject(parent)
+{
+}
+
+qint64 NiriStats::now()
+{
+    using namespace std::chrono;
+    return duration_cast<nanoseconds>(steady_clock::now().time_since_epoch()).count();
+}
+
+void NiriStats::setEnabled(bool enabled)
+{
+    if (this->enabled() == enabled) {
+        return;
+    }
+
+    m_enabled.store(enabled, std::memory_order_relaxed);
+    emit enabledChanged();
+}
+
+void NiriStats::setTracing(bool tracing)
+{
+    if (this->tracing() == tracing) {
+        return;
+    }
+
+    m_tracing.store(tracing, std::memory_order_relaxed);
+    emit tracingChanged();
+}
+
+void NiriStats::recordRead(qint64 bytes)
+{
+    m_readBytes.add(quint64(bytes));
+}
+
+void NiriStats::recordSpan(Span span, qint64 startNs, qint64 endNs)
+{
+    quint64 duration = quint64(qMax<qint64>(0, endNs - startNs));
+
+    switch (span) {
+    case ParseSpan:
+        m_parseNs.add(duration);
+        addTraceSpan("parse", "ipc", startNs, endNs);
+        break;
+    case IconLookupSpan:
+        m_iconLookupNs.add(duration);
+        addTraceSpan("icon lookup", "icon", startNs, endNs);
+        break;
+    case RequestSpan:
+        m_requestNs.add(duration);
+        addTraceSpan("request", "ipc", startNs, endNs);
+        break;
+    }
+}
+
+void NiriStats::recordHandler(NiriEvent::Type type, qint64 startNs, qint64 endNs)
+{
+    m_handlerNs[type].add(quint64(qMax<qint64>(0, endNs - startNs)));
+
+    // Trace span names have to outlive the buffer
+    static const std::array<QByteArray, NiriEvent::TypeCount> names = [] {
+        std::array<QByteArray, NiriEvent::TypeCount> names;
+        for (int type = 0; type < NiriEvent::TypeCount; ++type) {
+            names[type] = NiriEvent::typeName(NiriEvent::Type(type)).toLatin1();
+        }
+        return names;
+    }();
+    addTraceSpan(names[type].constData(), "handler", startNs, endNs);
+}
+
+void NiriStats::addTraceSpan(const char *name, const char *category, qint64 startNs, qint64 endNs)
+{
+    if (!tracing()) {
+        return;
+    }
+
+    quintptr threadId = quintptr(QThread::currentThreadId());
+
+    QMutexLocker locker(&m_traceMutex);
+    if (m_traceSpans.size() < s_maxTraceSpans) {
+        m_traceSpans.append({name, category, startNs, endNs, threadId});
+    }
+}
+
+QVariantMap NiriStats::snapshot() const
+{
+    QVariantMap handlers;
+    for (int type = 0; type < NiriEvent::TypeCount; ++type) {
+        if (m_handlerNs[type].count() > 0) {
+            handlers.insert(NiriEvent::typeName(NiriEvent::Type(type)),
+                            m_handlerNs[type].toVariantMap());
+        }
+    }
+
+    IconLookup::CacheStats cache = IconLookup::cacheStats();
+
+    return {
+        {"readBytes", m_readBytes.toVariantMap()},
+        {"parseNs", m_parseNs.toVariantMap()},
+        {"handlerNs", handlers},
+        {"iconLookupNs", m_iconLookupNs.toVariantMap()},
+        {"iconCache", QVariantMap{
+            {"hits", cache.hits},
+            {"misses", cache.misses},
+            {"evictions", cache.evictions},
+            {"size", cache.size},
+        }},
+        {"requestNs", m_requestNs.toVariantMap()},
+    };
+}
+
+void NiriStats::reset()
+{
+    m_readBytes.reset();
+    m_parseNs.reset();
+    m_iconLookupNs.reset();
+    m_requestNs.reset();
+    for (Log2Histogram &histogram : m_handlerNs) {
+        histogram.reset();
+    }
+
+    QMutexLocker locker(&m_traceMutex);
+    m_traceSpans.clear();
+}
+
+bool NiriStats::saveTrace(const QString &path)
+{
+    QList<TraceSpan> spans;
+    {
+        QMutexLocker locker(&m_traceMutex);
+        spans.swap(m_traceSpans);
+    }
+
+    QFile file(path);
+    if (!file.open(QIODevice::WriteOnly | QIODevice::Truncate)) {
+        qWarning() << "Failed to open trace file" << path << ":" << file.errorString();
+        return false;
+    }
+
+    // Complete events with microsecond timestamps relative to the first span
+    qint64 origin = spans.isEmpty() ? 0 : spans.first().startNs;
+    for (const TraceSpan &span : std::as_const(spans)) {
+        origin = qMin(origin, span.startNs);
+    }
+
+    const QByteArray pid = QByteArray::number(QCoreApplication::applicationPid());
+    QByteArray data = "{\"traceEvents\":[\n";
+    for (qsizetype i = 0; i < spans.size(); ++i) {
+        const TraceSpan &span = spans[i];
+        data += "{\"name\":\"";
+        data += span.name;
+        data += "\",\"cat\":\"";
+        data += span.category;
+        data += "\",\"ph\":\"X\",\"ts\":";
+        data += QByteArray::number((span.startNs - origin) / 1000.0, 'f', 3);
+        data += ",\"dur\":";
+        data += QByteArray::number((span.endNs - span.startNs) / 1000.0, 'f', 3);
+        data += ",\"pid\":";
+        data += pid;
+        data += ",\"tid\":";
+        data += QByteArray::number(quint64(span.threadId));
+        data += i + 1 < spans.size() ? "},\n" : "}\n";
+    }
+    data += "]}\n";
+
+    return file.write(data) == data.size();
+}
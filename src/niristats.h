@@ -0,0 +1,117 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <QList>
+#include <QMutex>
+#include <QObject>
+#include <QVariantMap>
+#include "events.h"
+
+/**
+ * Lock-free histogram with power of two buckets.
+ *
+ * Bucket 0 counts zeros and bucket n counts values in [2^(n-1), 2^n), so
+ * percentiles are reported as the upper bound of the bucket they fall in.
+ */
+class Log2Histogram
+{
+public:
+    static constexpr int BucketCount = 48;
+
+    void add(quint64 value);
+    void reset();
+    quint64 count() const { return m_count.load(std::memory_order_relaxed); }
+
+    // {count, sum, mean, max, p50, p90, p99, buckets}
+    QVariantMap toVariantMap() const;
+
+private:
+    quint64 percentile(double fraction) const;
+
+    std::array<std::atomic<quint64>, BucketCount> m_buckets{};
+    std::atomic<quint64> m_count{0};
+    std::atomic<quint64> m_sum{0};
+    std::atomic<quint64> m_max{0};
+};
+
+/**
+ * Process-wide hot path metrics, exposed to QML as Niri.stats.
+ *
+ * Collection is disabled by default; while disabled, instrumented code only
+ * pays for one relaxed atomic load. Recording functions are thread-safe.
+ * With tracing enabled, parse, handler, icon lookup and request spans are
+ * also kept for export in the Chrome trace event format.
+ */
+class NiriStats : public QObject
+{
+    Q_OBJECT
+    Q_PROPERTY(bool enabled READ enabled WRITE setEnabled NOTIFY enabledChanged)
+    Q_PROPERTY(bool tracing READ tracing WRITE setTracing NOTIFY tracingChanged)
+
+public:
+    enum Span {
+        ParseSpan,
+        IconLookupSpan,
+        RequestSpan
+    };
+
+    // Shared instance, owned by the application object
+    static NiriStats *instance();
+
+    bool enabled() const { return m_enabled.load(std::memory_order_relaxed); }
+    void setEnabled(bool enabled);
+
+    bool tracing() const { return m_tracing.load(std::memory_order_relaxed); }
+    void setTracing(bool tracing);
+
+    // Steady clock timestamp in nanoseconds
+    static qint64 now();
+
+    void recordRead(qint64 bytes);
+    void recordSpan(Span span, qint64 startNs, qint64 endNs);
+    void recordHandler(NiriEvent::Type type, qint64 startNs, qint64 endNs);
+
+    /**
+     * Current metrics: readBytes, parseNs, iconLookupNs and requestNs
+     * histograms, handlerNs histograms keyed by event type, and iconCache
+     * hit/miss counts.
+     */
+    Q_INVOKABLE QVariantMap snapshot() const;
+    Q_INVOKABLE void reset();
+
+    /**
+     * Write the spans recorded while tracing as Chrome trace event JSON, for
+     * chrome://tracing or Perfetto, and discard them.
+     */
+    Q_INVOKABLE bool saveTrace(const QString &path);
+
+signals:
+    void enabledChanged();
+    void tracingChanged();
+
+private:
+    struct TraceSpan {
+        const char *name;
+        const char *category;
+        qint64 startNs;
+        qint64 endNs;
+        quintptr threadId;
+    };
+
+    explicit NiriStats(QObject *parent = nullptr);
+
+    void addTraceSpan(const char *name, const char *category, qint64 startNs, qint64 endNs);
+
+    std::atomic<bool> m_enabled{false};
+    std::atomic<bool> m_tracing{false};
+
+    Log2Histogram m_readBytes;
+    Log2Histogram m_parseNs;
+    Log2Histogram m_iconLookupNs;
+    Log2Histogram m_requestNs;
+    std::array<Log2Histogram, NiriEvent::TypeCount> m_handlerNs;
+
+    QMutex m_traceMutex;
+    QList<TraceSpan> m_traceSpans;
+};
@@ -0,0 +1,244 @@
+#include <algorithm>
+#include <QDebug>
+#include <QJsonArray>
+#include <QSet>
+#include "outputmodel.h"
+#include "stringpool.h"
+
+OutputModel::OutputModel(QObject *parent)
+    : QAbstractListModel(parent)
+{
+}
+
+int OutputModel::rowCount(const QModelIndex &parent) const
+{
+    if (parent.isValid())
+        return 0;
+    return m_outputs.count();
+}
+
+QVariant OutputModel::data(const QModelIndex &index, int role) const
+{
+    if (!index.isValid() || index.row() >= m_outputs.count())
+        return QVariant();
+
+    const Output &output = m_outputs.at(index.row());
+
+    switch (role) {
+    case NameRole:
+        return output.name;
+    case OutputKeyRole:
+        return output.key;
+    case MakeRole:
+        return output.make;
+    case ModelRole:
+        return output.model;
+    case SerialRole:
+        return output.serial;
+    case PhysicalSizeRole:
+        return output.physicalSize;
+    case ModeSizeRole:
+        return output.modeSize;
+    case RefreshRateRole:
+        return output.refreshRate;
+    case VrrEnabledRole:
+        return output.vrrEnabled;
+    case IsEnabledRole:
+        return output.isEnabled;
+    case LogicalGeometryRole:
+        return output.logicalGeometry;
+    case ScaleRole:
+        return output.scale;
+    case TransformRole:
+        return output.transform;
+    case IsFocusedRole:
+        return output.isFocused;
+    default:
+        return QVariant();
+    }
+}
+
+QHash<int, QByteArray> OutputModel::roleNames() const
+{
+    QHash<int, QByteArray> roles;
+    roles[NameRole] = "name";
+    roles[OutputKeyRole] = "outputKey";
+    roles[MakeRole] = "make";
+    roles[ModelRole] = "model";
+    roles[SerialRole] = "serial";
+    roles[PhysicalSizeRole] = "physicalSize";
+    roles[ModeSizeRole] = "modeSize";
+    roles[RefreshRateRole] = "refreshRate";
+    roles[VrrEnabledRole] = "vrrEnabled";
+    roles[IsEnabledRole] = "isEnabled";
+    roles[LogicalGeometryRole] = "logicalGeometry";
+    roles[ScaleRole] = "scale";
+    roles[TransformRole] = "transform";
+    roles[IsFocusedRole] = "isFocused";
+    return roles;
+}
+
+QSet<int> OutputModel::enabledOutputKeys() const
+{
+    QSet<int> keys;
+    for (const Output &output : m_outputs) {
+        if (output.isEnabled) {
+            keys.insert(output.key);
+        }
+    }
+    return keys;
+}
+
+Output OutputModel::parseOutput(const QJsonObject &obj)
+{
+    Output output;
+    output.name = StringPool::intern(obj["name"].toString(), &output.key);
+    output.make = obj["make"].toString();
+    output.model = obj["model"].toString();
+    output.serial = obj["serial"].toString();
+
+    const QJsonArray physicalSize = obj["physical_size"].toArray();
+    if (physicalSize.size() == 2) {
+        output.physicalSize = QSize(physicalSize[0].toInt(), physicalSize[1].toInt());
+    }
+
+    const QJsonArray modes = obj["modes"].toArray();
+    QJsonValue currentMode = obj["current_mode"];
+    if (!currentMode.isNull() && currentMode.toInt() < modes.size()) {
+        const QJsonObject mode = modes[currentMode.toInt()].toObject();
+        output.modeSize = QSize(mode["width"].toInt(), mode["height"].toInt());
+        // Reported in millihertz
+        output.refreshRate = mode["refresh_rate"].toDouble() / 1000.0;
+    }
+    output.vrrEnabled = obj["vrr_enabled"].toBool();
+
+    const QJsonObject logical = obj["logical"].toObject();
+    if (!logical.isEmpty()) {
+        output.isEnabled = true;
+        output.logicalGeometry = QRect(logical["x"].toInt(), logical["y"].toInt(),
+                                       logical["width"].toInt(), logical["height"].toInt());
+        output.scale = logical["scale"].toDouble(1);
+        output.transform = logical["transform"].toString();
+    }
+
+    return output;
+}
+
+void OutputModel::handleOutputs(const QJsonObject &outputs)
+{
+    QList<Output> sorted;
+    sorted.reserve(outputs.size());
+    for (auto it = outputs.constBegin(); it != outputs.constEnd(); ++it) {
+        Output output = parseOutput(it.value().toObject());
+        if (output.name.isEmpty()) {
+            output.name = StringPool::intern(it.key(), &output.key);
+        }
+        output.isFocused = output.key == m_focusedKey;
+        sorted.append(output);
+    }
+
+    std::sort(sorted.begin(), sorted.end(), [](const Output &a, const Output &b) {
+        return a.name < b.name;
+    });
+
+    // Reconcile by key instead of resetting the model, like the other models
+    int oldCount = m_outputs.count();
+
+    QSet<quint64> keys;
+    for (const Output &output : std::as_const(sorted)) {
+        keys.insert(output.key);
+    }
+
+    for (int last = m_outputs.count() - 1; last >= 0; --last) {
+        if (keys.contains(m_outputs[last].key)) {
+            continue;
+        }
+
+        int first = last;
+        while (first > 0 && !keys.contains(m_outputs[first - 1].key)) {
+            --first;
+        }
+
+        beginRemoveRows(QModelIndex(), first, last);
+        for (int row = last; row >= first; --row) {
+            m_outputs.removeAt(row);
+            m_index.remove(row);
+        }
+        endRemoveRows();
+
+        last = first;
+    }
+
+    int i = 0;
+    for (const Output &output : std::as_const(sorted)) {
+        int row = m_index.row(output.key);
+
+        if (row == -1) {
+            beginInsertRows(QModelIndex(), i, i);
+            m_outputs.insert(i, output);
+            m_index.insert(i, output.key);
+            endInsertRows();
+        } else {
+            if (row != i) {
+                beginMoveRows(QModelIndex(), row, row, QModelIndex(), i);
+                m_outputs.move(row, i);
+                m_index.move(row, i);
+                endMoveRows();
+            }
+            updateOutput(i, output);
+        }
+        ++i;
+    }
+
+    if (m_outputs.count() != oldCount) {
+        emit countChanged();
+    }
+}
+
+void OutputModel::updateOutput(int row, const Output &output)
+{
+    Output &current = m_outputs[row];
+    QList<int> roles;
+
+    auto update = [&roles](auto &field, const auto &value, int role) {
+        if (field != value) {
+            field = value;
+            roles.append(role);
+        }
+    };
+
+    update(current.make, output.make, MakeRole);
+    update(current.model, output.model, ModelRole);
+    update(current.serial, output.serial, SerialRole);
+    update(current.physicalSize, output.physicalSize, PhysicalSizeRole);
+    update(current.modeSize, output.modeSize, ModeSizeRole);
+    update(current.refreshRate, output.refreshRate, RefreshRateRole);
+    update(current.vrrEnabled, output.vrrEnabled, VrrEnabledRole);
+    update(current.isEnabled, output.isEnabled, IsEnabledRole);
+    update(current.logicalGeometry, output.logicalGeometry, LogicalGeometryRole);
+    update(current.scale, output.scale, ScaleRole);
+    update(current.transform, output.transform, TransformRole);
+    update(current.isFocused, output.isFocused, IsFocusedRole);
+
+    if (!roles.isEmpty()) {
+        QModelIndex modelIdx = index(row);
+        emit dataChanged(modelIdx, modelIdx, roles);
+    }
+}
+
+void OutputModel::setFocusedOutput(int key)
+{
+    if (m_focusedKey == key) {
+        return;
+    }
+
+    // Only the previously and newly focused rows change
+    for (int row : {m_index.row(m_focusedKey), m_index.row(key)}) {
+        if (row != -1) {
+            m_outputs[row].isFocused = m_outputs[row].key == key;
+            QModelIndex modelIdx = index(row);
+            emit dataChanged(modelIdx, modelIdx, {IsFocusedRole});
+        }
+    }
+    m_focusedKey = key;
+}
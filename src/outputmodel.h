@@ -0,0 +1,90 @@
+#pragma once
+
+#include <QAbstractListModel>
+#include <QJsonObject>
+#include <QRect>
+#include <QSize>
+#include "rowindex.h"
+
+struct Output {
+    QString name;
+    // StringPool key of name, shared with Workspace::outputKey
+    int key = 0;
+    QString make;
+    QString model;
+    QString serial;
+    // Physical size in millimeters, empty if unknown
+    QSize physicalSize;
+    // Current mode, empty if the output is off
+    QSize modeSize;
+    double refreshRate = 0;
+    bool vrrEnabled = false;
+    // Logical geometry, only for enabled outputs
+    bool isEnabled = false;
+    QRect logicalGeometry;
+    double scale = 1;
+    QString transform;
+    bool isFocused = false;
+};
+
+/**
+ * List model of the outputs (monitors) known to niri, sorted by name.
+ *
+ * niri doesn't send output events, so the model is filled from replies to
+ * "Outputs" requests, which Niri sends when connecting, when the config is
+ * reloaded and when the set of outputs with workspaces changes. Replies are
+ * reconciled by output name, so only changed rows are notified.
+ */
+class OutputModel : public QAbstractListModel
+{
+    Q_OBJECT
+    Q_PROPERTY(int count READ rowCount NOTIFY countChanged)
+
+public:
+    enum OutputRoles {
+        NameRole = Qt::UserRole + 1,
+        OutputKeyRole,
+        MakeRole,
+        ModelRole,
+        SerialRole,
+        PhysicalSizeRole,
+        ModeSizeRole,
+        RefreshRateRole,
+        VrrEnabledRole,
+        IsEnabledRole,
+        LogicalGeometryRole,
+        ScaleRole,
+        TransformRole,
+        IsFocusedRole
+    };
+
+    explicit OutputModel(QObject *parent = nullptr);
+
+    int rowCount(const QModelIndex &parent = QModelIndex()) const override;
+    QVariant data(const QModelIndex &index, int role = Qt::DisplayRole) const override;
+    QHash<int, QByteArray> roleNames() const override;
+
+    // Keys of the enabled outputs
+    QSet<int> enabledOutputKeys() const;
+
+    /**
+     * Reconcile with the outputs of an "Outputs" reply, i.e. the object
+     * mapping output names to their description.
+     */
+    void handleOutputs(const QJsonObject &outputs);
+
+    // Flag the output with the given key as focused, 0 for none
+    void setFocusedOutput(int key);
+
+    static Output parseOutput(const QJsonObject &obj);
+
+signals:
+    void countChanged();
+
+private:
+    void updateOutput(int row, const Output &output);
+
+    QList<Output> m_outputs;
+    RowIndex m_index;
+    int m_focusedKey = 0;
+};
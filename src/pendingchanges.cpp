@@ -0,0 +1,45 @@
+#include <utility>
+#include "pendingchanges.h"
+
+PendingChanges::PendingChanges(FlushFunction flush)
+    : m_flush(std::move(flush))
+{
+    m_timer.setSingleShot(true);
+    QObject::connect(&m_timer, &QTimer::timeout, &m_timer, [this] { m_flush(); });
+}
+
+void PendingChanges::setInterval(int interval)
+{
+    m_interval = interval;
+
+    if (isEnabled()) {
+        m_timer.setInterval(interval);
+    } else if (m_timer.isActive()) {
+        m_timer.stop();
+        m_flush();
+    }
+}
+
+void PendingChanges::add(quint64 id, const QList<int> &roles)
+{
+    QList<int> &pending = m_changes[id];
+    for (int role : roles) {
+        if (!pending.contains(role)) {
+            pending.append(role);
+        }
+    }
+    schedule();
+}
+
+void PendingChanges::schedule()
+{
+    if (!m_timer.isActive()) {
+        m_timer.start();
+    }
+}
+
+QHash<quint64, QList<int>> PendingChanges::take()
+{
+    m_timer.stop();
+    return std::exchange(m_changes, {});
+}
@@ -0,0 +1,38 @@
+#pragma once
+
+#include <functional>
+#include <utility>
+#include <QHash>
+#include <QList>
+#include <QTimer>
+
+/**
+ * Batches role change notifications of a list model.
+ *
+ * Changed roles are merged per id and flushed together, either on the next
+ * event loop turn (interval 0) or after a fixed interval in milliseconds.
+ * Batching is disabled with a negative interval, which is the default.
+ */
+class PendingChanges
+{
+public:
+    using FlushFunction = std::function<void()>;
+
+    explicit PendingChanges(FlushFunction flush);
+
+    int interval() const { return m_interval; }
+    // Disabling batching flushes pending changes immediately
+    void setInterval(int interval);
+    bool isEnabled() const { return m_interval >= 0; }
+
+    void add(quint64 id, const QList<int> &roles);
+    // Request a flush without row changes, e.g. for model-level signals
+    void schedule();
+    QHash<quint64, QList<int>> take();
+
+private:
+    FlushFunction m_flush;
+    QTimer m_timer;
+    int m_interval = -1;
+    QHash<quint64, QList<int>> m_changes;
+};
@@ -12,6 +12,9 @@ public:
     {
         Q_ASSERT(uri == QLatin1String("Niri"));
         qmlRegisterType<Niri>(uri, 0, 1, "Niri");
+        // For its enums, instances come from Niri
+        qmlRegisterUncreatableType<WindowModel>(uri, 0, 1, "WindowModel",
+                                                QStringLiteral("Use niri.windows"));
     }
 };
 
@@ -0,0 +1,45 @@
+#include "rowindex.h"
+#include <algorithm>
+
+void RowIndex::insert(int row, quint64 id)
+{
+    m_ids.insert(row, id);
+    renumber(row, m_ids.count() - 1);
+}
+
+void RowIndex::remove(int row)
+{
+    m_rows.remove(m_ids.takeAt(row));
+    renumber(row, m_ids.count() - 1);
+}
+
+void RowIndex::move(int from, int to)
+{
+    if (from == to) {
+        return;
+    }
+
+    m_ids.move(from, to);
+    renumber(std::min(from, to), std::max(from, to));
+}
+
+void RowIndex::reset(const QList<quint64> &ids)
+{
+    m_ids = ids;
+    m_rows.clear();
+    m_rows.reserve(m_ids.count());
+    renumber(0, m_ids.count() - 1);
+}
+
+void RowIndex::clear()
+{
+    m_ids.clear();
+    m_rows.clear();
+}
+
+void RowIndex::renumber(int first, int last)
+{
+    for (int i = first; i <= last; ++i) {
+        m_rows[m_ids[i]] = i;
+    }
+}
@@ -0,0 +1,32 @@
+#pragma once
+
+#include <QHash>
+#include <QList>
+
+/**
+ * Maps ids to the rows of a list model.
+ *
+ * Lookups are O(1). Inserting or removing a row renumbers the rows after it,
+ * so appending and removing from the end, the common cases, stay cheap.
+ */
+class RowIndex
+{
+public:
+    int row(quint64 id) const { return m_rows.value(id, -1); }
+    bool contains(quint64 id) const { return m_rows.contains(id); }
+    quint64 id(int row) const { return m_ids.at(row); }
+    int count() const { return m_ids.count(); }
+
+    void insert(int row, quint64 id);
+    void remove(int row);
+    // Same semantics as QList::move()
+    void move(int from, int to);
+    void reset(const QList<quint64> &ids);
+    void clear();
+
+private:
+    void renumber(int first, int last);
+
+    QHash<quint64, int> m_rows;
+    QList<quint64> m_ids;
+};
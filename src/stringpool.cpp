@@ -0,0 +1,68 @@
+#include "stringpool.h"
+
+namespace {
+
+struct Pool {
+    QReadWriteLock lock;
+    QHash<QString, int> keys;
+    // Strings by key, key 0 is the empty string
+    QList<QString> strings{QString()};
+};
+
+Pool &pool()
+{
+    static Pool s_pool;
+    return s_pool;
+}
+
+}
+
+QString StringPool::intern(const QString &str, int *key)
+{
+    if (str.isEmpty()) {
+        if (key) {
+            *key = 0;
+        }
+        return QString();
+    }
+
+    Pool &p = pool();
+    {
+        QReadLocker locker(&p.lock);
+        auto it = p.keys.constFind(str);
+        if (it != p.keys.constEnd()) {
+            if (key) {
+                *key = it.value();
+            }
+            // The hash key shares its data with the pooled string
+            return it.key();
+        }
+    }
+
+    QWriteLocker locker(&p.lock);
+    // Another thread may have interned it in the meantime
+    auto it = p.keys.constFind(str);
+    if (it == p.keys.constEnd()) {
+        it = p.keys.insert(str, p.strings.size());
+        p.strings.append(str);
+    }
+
+    if (key) {
+        *key = it.value();
+    }
+    return it.key();
+}
+
+int StringPool::key(const QString &str)
+{
+    int key = 0;
+    intern(str, &key);
+    return key;
+}
+
+QString StringPool::string(int key)
+{
+    Pool &p = pool();
+    QReadLocker locker(&p.lock);
+    return p.strings.value(key);
+}
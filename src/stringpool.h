@@ -0,0 +1,32 @@
+#pragma once
+
+#include <QHash>
+#include <QList>
+#include <QReadWriteLock>
+#include <QString>
+
+/**
+ * Process-wide table of interned strings.
+ *
+ * Meant for the small sets of values that repeat across events, such as app
+ * IDs, output names and workspace names, not for unbounded ones like window
+ * titles: entries are never removed. Interned copies of equal strings share
+ * one allocation, and each distinct string gets a small integer key, so they
+ * can be compared and grouped as integers. Thread-safe.
+ */
+namespace StringPool {
+
+/**
+ * Return the shared instance of str.
+ *
+ * @param key If not null, set to the key of str; the empty string is 0
+ */
+QString intern(const QString &str, int *key = nullptr);
+
+// Key of str, interning it if needed
+int key(const QString &str);
+
+// The interned string of a key, or an empty string for unknown keys
+QString string(int key);
+
+}
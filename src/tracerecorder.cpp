@@ -0,0 +1,117 @@
+#include "tracerecorder.h"
+#include <chrono>
+#include <QDebug>
+
+// Wake the writer early once this much is buffered
+static constexpr qsizetype FlushThreshold = 64 * 1024;
+// Drop lines instead of growing the buffer further if the disk can't keep up
+static constexpr qsizetype MaxBufferSize = 16 * 1024 * 1024;
+static constexpr unsigned long FlushIntervalMs = 500;
+
+TraceRecorder::~TraceRecorder()
+{
+    stop();
+}
+
+qint64 TraceRecorder::monotonicMicroseconds()
+{
+    using namespace std::chrono;
+    return duration_cast<microseconds>(steady_clock::now().time_since_epoch()).count();
+}
+
+bool TraceRecorder::start(const QString &path)
+{
+    stop();
+
+    m_file.setFileName(path);
+    if (!m_file.open(QIODevice::WriteOnly | QIODevice::Truncate)) {
+        qWarning() << "Failed to open trace file" << path << ":" << m_file.errorString();
+        return false;
+    }
+
+    {
+        // record() only checks m_recording before taking the lock, so it may
+        // still be appending from another thread
+        QMutexLocker locker(&m_mutex);
+        m_stopping = false;
+        m_droppedLines = 0;
+        m_buffer.clear();
+    }
+    m_writer = QThread::create([this] { writeLoop(); });
+    m_writer->setObjectName("niri-trace");
+    m_writer->start();
+
+    qDebug() << "Recording event stream to" << path;
+    m_recording = true;
+    return true;
+}
+
+void TraceRecorder::stop()
+{
+    if (!m_writer) {
+        return;
+    }
+
+    m_recording = false;
+    {
+        QMutexLocker locker(&m_mutex);
+        m_stopping = true;
+        m_wakeWriter.wakeOne();
+    }
+    m_writer->wait();
+    delete m_writer;
+    m_writer = nullptr;
+    m_file.close();
+
+    if (m_droppedLines > 0) {
+        qWarning() << "Trace recording dropped" << m_droppedLines << "lines";
+    }
+}
+
+void TraceRecorder::record(const QByteArray &line)
+{
+    if (!m_recording) {
+        return;
+    }
+
+    QByteArray timestamp = QByteArray::number(monotonicMicroseconds());
+
+    QMutexLocker locker(&m_mutex);
+    if (m_buffer.size() >= MaxBufferSize) {
+        ++m_droppedLines;
+        return;
+    }
+
+    m_buffer.append(timestamp);
+    m_buffer.append('\t');
+    m_buffer.append(line);
+    m_buffer.append('\n');
+
+    if (m_buffer.size() >= FlushThreshold) {
+        m_wakeWriter.wakeOne();
+    }
+}
+
+void TraceRecorder::writeLoop()
+{
+    QByteArray data;
+    bool stopping = false;
+
+    while (!stopping) {
+        {
+            QMutexLocker locker(&m_mutex);
+            if (!m_stopping && m_buffer.size() < FlushThreshold) {
+                m_wakeWriter.wait(&m_mutex, FlushIntervalMs);
+            }
+            data.swap(m_buffer);
+            stopping = m_stopping;
+        }
+
+        if (!data.isEmpty()) {
+            m_file.write(data);
+            m_file.flush();
+            // Keep the capacity for the next swap
+            data.resize(0);
+        }
+    }
+}
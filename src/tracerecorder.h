@@ -0,0 +1,46 @@
+#pragma once
+
+#include <atomic>
+#include <QByteArray>
+#include <QFile>
+#include <QMutex>
+#include <QString>
+#include <QThread>
+#include <QWaitCondition>
+
+/**
+ * Records raw event stream lines to a trace file.
+ *
+ * Each line is written as "<monotonic_us>\t<json>\n", the format replayed
+ * by the benchmark's fake niri server. record() only appends to a buffer
+ * under a mutex; a writer thread flushes it to disk when it grows large or
+ * periodically, so the reading thread never blocks on file I/O.
+ */
+class TraceRecorder
+{
+public:
+    TraceRecorder() = default;
+    ~TraceRecorder();
+
+    bool start(const QString &path);
+    void stop();
+    bool isRecording() const { return m_recording; }
+
+    // Safe to call from any thread; a no-op unless recording
+    void record(const QByteArray &line);
+
+    static qint64 monotonicMicroseconds();
+
+private:
+    void writeLoop();
+
+    std::atomic<bool> m_recording{false};
+    QFile m_file;
+    QThread *m_writer = nullptr;
+
+    QMutex m_mutex;
+    QWaitCondition m_wakeWriter;
+    QByteArray m_buffer;
+    bool m_stopping = false;
+    quint64 m_droppedLines = 0;
+};
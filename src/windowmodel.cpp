@@ -1,17 +1,24 @@
 #include <algorithm>
+#include <climits>
+#include <tuple>
 #include <QDebug>
-#include <QJsonArray>
-#include "icon.h"
+#include <QQmlEngine>
+#include <QSet>
+#include "iconresolver.h"
 #include "windowmodel.h"
+#include "workspacemodel.h"
 
 WindowModel::WindowModel(QObject *parent)
     : QAbstractListModel(parent)
+    , m_pendingChanges([this] { flushChanges(); })
 {
+    QObject::connect(IconResolver::instance(), &IconResolver::iconResolved,
+                     this, &WindowModel::onIconResolved);
 }
 
 WindowModel::~WindowModel()
 {
-    qDeleteAll(m_windows);
+    qDeleteAll(m_windowObjects);
 }
 
 int WindowModel::rowCount(const QModelIndex &parent) const
@@ -26,27 +33,37 @@ QVariant WindowModel::data(const QModelIndex &index, int role) const
     if (!index.isValid() || index.row() >= m_windows.count())
         return QVariant();
 
-    const Window *win = m_windows.at(index.row());
+    const WindowEntry &win = m_windows.at(index.row());
 
     switch (role) {
     case IdRole:
-        return QVariant::fromValue(win->id);
+        return QVariant::fromValue(win.id);
     case TitleRole:
-        return win->title;
+        return win.title;
     case AppIdRole:
-        return win->appId;
+        return win.appId;
     case PidRole:
-        return win->pid;
+        return win.pid;
     case WorkspaceIdRole:
-        return QVariant::fromValue(win->workspaceId);
+        return QVariant::fromValue(win.workspaceId);
     case IsFocusedRole:
-        return win->isFocused;
+        return win.isFocused;
     case IsFloatingRole:
-        return win->isFloating;
+        return win.isFloating;
     case IsUrgentRole:
-        return win->isUrgent;
+        return win.isUrgent;
     case IconPathRole:
-        return win->iconPath;
+        return win.iconPath;
+    case TileSizeRole:
+        return win.layout.tileSize;
+    case WindowSizeRole:
+        return win.layout.windowSize;
+    case ColumnRole:
+        return win.layout.column;
+    case TileIndexRole:
+        return win.layout.tile;
+    case TilePositionRole:
+        return win.layout.hasTilePosition ? QVariant(win.layout.tilePosition) : QVariant();
     default:
         return QVariant();
     }
@@ -64,87 +81,179 @@ QHash<int, QByteArray> WindowModel::roleNames() const
     roles[IsFloatingRole] = "isFloating";
     roles[IsUrgentRole] = "isUrgent";
     roles[IconPathRole] = "iconPath";
+    roles[TileSizeRole] = "tileSize";
+    roles[WindowSizeRole] = "windowSize";
+    roles[ColumnRole] = "column";
+    roles[TileIndexRole] = "tileIndex";
+    roles[TilePositionRole] = "tilePosition";
     return roles;
 }
 
-void WindowModel::handleEvent(const QJsonObject &event)
+QList<NiriEvent::Type> WindowModel::handledEvents()
 {
-    if (event.contains("WindowsChanged")) {
-        QJsonArray windows = event["WindowsChanged"].toObject()["windows"].toArray();
-        handleWindowsChanged(windows);
-    }
-    else if (event.contains("WindowOpenedOrChanged")) {
-        QJsonObject window = event["WindowOpenedOrChanged"].toObject()["window"].toObject();
-        handleWindowOpenedOrChanged(window);
+    return {
+        NiriEvent::WindowsChanged,
+        NiriEvent::WindowOpenedOrChanged,
+        NiriEvent::WindowClosed,
+        NiriEvent::WindowFocusChanged,
+        NiriEvent::WindowUrgencyChanged,
+        NiriEvent::WindowLayoutsChanged,
+    };
+}
+
+void WindowModel::handleEvent(const NiriEvent &event)
+{
+    switch (event.type) {
+    case NiriEvent::WindowsChanged:
+        handleWindowsChanged(event.get<Events::WindowsChanged>().windows);
+        break;
+    case NiriEvent::WindowOpenedOrChanged:
+        handleWindowOpenedOrChanged(event.get<Events::WindowOpenedOrChanged>().window);
+        break;
+    case NiriEvent::WindowClosed:
+        handleWindowClosed(event.get<Events::WindowClosed>().id);
+        break;
+    case NiriEvent::WindowFocusChanged:
+        handleWindowFocusChanged(event.get<Events::WindowFocusChanged>().id);
+        break;
+    case NiriEvent::WindowUrgencyChanged: {
+        const auto &data = event.get<Events::WindowUrgencyChanged>();
+        handleWindowUrgencyChanged(data.id, data.urgent);
+        break;
     }
-    else if (event.contains("WindowClosed")) {
-        quint64 id = event["WindowClosed"].toObject()["id"].toInteger();
-        handleWindowClosed(id);
+    case NiriEvent::WindowLayoutsChanged:
+        handleWindowLayoutsChanged(event.get<Events::WindowLayoutsChanged>());
+        break;
+    default:
+        break;
     }
-    else if (event.contains("WindowFocusChanged")) {
-        QJsonValue id = event["WindowFocusChanged"].toObject()["id"];
-        handleWindowFocusChanged(id);
+}
+
+void WindowModel::handleWindowsChanged(const QList<WindowData> &snapshot)
+{
+    QList<WindowData> sorted;
+    if (m_sortMode == PositionSort) {
+        // The rows end up in this order, which also covers a pending resort
+        m_resortPending = false;
+        sorted = snapshot;
+        std::stable_sort(sorted.begin(), sorted.end(),
+                         [this](const WindowData &a, const WindowData &b) { return lessThan(a, b); });
     }
-    else if (event.contains("WindowUrgencyChanged")) {
-        QJsonObject data = event["WindowUrgencyChanged"].toObject();
-        quint64 id = data["id"].toInteger();
-        bool urgent = data["urgent"].toBool();
-        handleWindowUrgencyChanged(id, urgent);
+    const QList<WindowData> &windows = (m_sortMode == PositionSort) ? sorted : snapshot;
+
+    // Reconcile with the snapshot by id instead of resetting the model, so
+    // delegates of windows that are still around survive it.
+    int oldCount = m_windows.count();
+
+    QSet<quint64> ids;
+    ids.reserve(windows.count());
+    for (const WindowData &data : windows) {
+        ids.insert(data.id);
     }
-    else if (event.contains("WindowLayoutsChanged")) {
-        QJsonArray changes = event["WindowLayoutsChanged"].toObject()["changes"].toArray();
-        handleWindowLayoutsChanged(changes);
+
+    // Remove windows missing from the snapshot, in contiguous ranges from the end
+    for (int last = m_windows.count() - 1; last >= 0; --last) {
+        if (ids.contains(m_windows[last].id)) {
+            continue;
+        }
+
+        int first = last;
+        while (first > 0 && !ids.contains(m_windows[first - 1].id)) {
+            --first;
+        }
+
+        beginRemoveRows(QModelIndex(), first, last);
+        for (int row = last; row >= first; --row) {
+            quint64 id = m_windows[row].id;
+            if (id == m_focusedId) {
+                m_focusedId = 0;
+            }
+            m_windows.removeAt(row);
+            m_index.remove(row);
+            removeWindowObject(id);
+        }
+        endRemoveRows();
+
+        last = first;
     }
-}
 
-void WindowModel::handleWindowsChanged(const QJsonArray &windows)
-{
-    beginResetModel();
-    qDeleteAll(m_windows);
-    m_windows.clear();
+    // Insert, move and update the remaining rows to match the snapshot order.
+    // Rows before i are already in place, so an existing window is always
+    // moved up.
+    quint64 focusedId = 0;
+    int i = 0;
+    for (const WindowData &data : windows) {
+        int row = findWindowIndex(data.id);
+
+        if (row != -1 && row < i) {
+            qWarning() << "Duplicate window in snapshot:" << data.id;
+            continue;
+        }
+
+        if (row == -1) {
+            beginInsertRows(QModelIndex(), i, i);
+            m_windows.insert(i, createEntry(data));
+            m_index.insert(i, data.id);
+            endInsertRows();
+        } else {
+            if (row != i) {
+                beginMoveRows(QModelIndex(), row, row, QModelIndex(), i);
+                m_windows.move(row, i);
+                m_index.move(row, i);
+                endMoveRows();
+            }
+            updateWindow(i, data);
+        }
 
-    for (const QJsonValue &value : windows) {
-        if (value.isObject()) {
-            m_windows.append(parseWindow(value.toObject()));
+        if (m_windows[i].isFocused && !focusedId) {
+            focusedId = data.id;
         }
+        ++i;
     }
 
-    endResetModel();
-    emit countChanged();
-    updateFocusedWindow();
+    if (m_windows.count() != oldCount) {
+        emit countChanged();
+    }
+    setFocusedWindow(focusedId);
 }
 
-void WindowModel::handleWindowOpenedOrChanged(const QJsonObject &windowObj)
+void WindowModel::handleWindowOpenedOrChanged(const WindowData &data)
 {
-    Window *window = parseWindow(windowObj);
-    int idx = findWindowIndex(window->id);
+    int idx = findWindowIndex(data.id);
+    bool changed = true;
+    QList<int> roles;
 
     if (idx == -1) {
-        // New window
-        beginInsertRows(QModelIndex(), m_windows.count(), m_windows.count());
-        m_windows.append(window);
+        // New window, placed by binary search, which needs sorted rows
+        if (m_resortPending) {
+            resort();
+        }
+        idx = insertionRow(data);
+        beginInsertRows(QModelIndex(), idx, idx);
+        m_windows.insert(idx, createEntry(data));
+        m_index.insert(idx, data.id);
         endInsertRows();
         emit countChanged();
     } else {
-        // Replace existing window pointer. This deallocates and reallocates even for
-        // minor changes (e.g. title updates), but avoids property-by-property copying.
-        delete m_windows[idx];
-        m_windows[idx] = window;
-        QModelIndex modelIdx = index(idx);
-        emit dataChanged(modelIdx, modelIdx);
-    }
-
-    // If this window is focused, update all other windows
-    if (window->isFocused) {
-        for (int i = 0; i < m_windows.count(); ++i) {
-            if (m_windows[i]->id != window->id && m_windows[i]->isFocused) {
-                m_windows[i]->isFocused = false;
-                QModelIndex modelIdx = index(i);
-                emit dataChanged(modelIdx, modelIdx, {IsFocusedRole});
-            }
+        // Update the existing window in place, so that window objects held
+        // by QML stay valid and only the roles that changed are notified.
+        roles = updateWindow(idx, data);
+        changed = !roles.isEmpty();
+    }
+
+    // If this window is focused, unfocus the previously focused window
+    if (m_windows[idx].isFocused) {
+        if (data.id != m_focusedId) {
+            unfocusRow(findWindowIndex(m_focusedId));
+            setFocusedWindow(data.id);
+        } else if (changed) {
+            setFocusedWindow(data.id);
         }
-        updateFocusedWindow();
+    } else if (data.id == m_focusedId) {
+        setFocusedWindow(0);
     }
+
+    reposition(idx, roles);
 }
 
 void WindowModel::handleWindowClosed(quint64 id)
@@ -155,33 +264,44 @@ void WindowModel::handleWindowClosed(quint64 id)
         return;
     }
 
-    bool wasFocused = m_windows[idx]->isFocused;
+    bool wasFocused = (id == m_focusedId);
+    if (wasFocused) {
+        m_focusedId = 0;
+    }
 
     beginRemoveRows(QModelIndex(), idx, idx);
-    delete m_windows.takeAt(idx);
+    m_windows.removeAt(idx);
+    m_index.remove(idx);
     endRemoveRows();
 
     emit countChanged();
 
     if (wasFocused) {
-        updateFocusedWindow();
+        setFocusedWindow(0);
     }
+    removeWindowObject(id);
 }
 
-void WindowModel::handleWindowFocusChanged(const QJsonValue &idValue)
+void WindowModel::handleWindowFocusChanged(quint64 newFocusedId)
 {
-    quint64 newFocusedId = idValue.isNull() ? 0 : idValue.toInteger();
+    // Only the previously and newly focused rows change
+    int oldRow = findWindowIndex(m_focusedId);
+    int newRow = newFocusedId ? findWindowIndex(newFocusedId) : -1;
 
-    for (int i = 0; i < m_windows.count(); ++i) {
-        bool shouldBeFocused = (m_windows[i]->id == newFocusedId);
-        if (m_windows[i]->isFocused != shouldBeFocused) {
-            m_windows[i]->isFocused = shouldBeFocused;
-            QModelIndex modelIdx = index(i);
-            emit dataChanged(modelIdx, modelIdx, {IsFocusedRole});
+    if (oldRow != newRow) {
+        unfocusRow(oldRow);
+    }
+
+    quint64 focusedId = 0;
+    if (newRow != -1) {
+        focusedId = newFocusedId;
+        if (!m_windows[newRow].isFocused) {
+            m_windows[newRow].isFocused = true;
+            notifyChanged(newRow, {IsFocusedRole});
         }
     }
 
-    updateFocusedWindow();
+    setFocusedWindow(focusedId);
 }
 
 void WindowModel::handleWindowUrgencyChanged(quint64 id, bool urgent)
@@ -192,67 +312,420 @@ void WindowModel::handleWindowUrgencyChanged(quint64 id, bool urgent)
         return;
     }
 
-    if (m_windows[idx]->isUrgent != urgent) {
-        m_windows[idx]->isUrgent = urgent;
-        QModelIndex modelIdx = index(idx);
-        emit dataChanged(modelIdx, modelIdx, {IsUrgentRole});
+    if (m_windows[idx].isUrgent != urgent) {
+        m_windows[idx].isUrgent = urgent;
+        notifyChanged(idx, {IsUrgentRole});
     }
 }
 
-void WindowModel::handleWindowLayoutsChanged(const QJsonArray &changes)
+void WindowModel::handleWindowLayoutsChanged(const Events::WindowLayoutsChanged &changes)
 {
-    // Window layout changes don't affect the properties we're tracking
-    // This is mostly for position/size which we're not exposing yet
-    Q_UNUSED(changes);
+    // Only the listed windows change, and only in their geometry roles
+    for (const auto &[id, layout] : changes.changes) {
+        int row = findWindowIndex(id);
+        if (row == -1) {
+            qWarning() << "Window not found for layout change:" << id;
+            continue;
+        }
+
+        QList<int> roles;
+        updateLayout(m_windows[row].layout, layout, roles);
+        notifyChanged(row, roles);
+        reposition(row, roles);
+    }
 }
 
-Window* WindowModel::parseWindow(const QJsonObject &obj)
+WindowEntry WindowModel::createEntry(const WindowData &data) const
 {
-    Window *win = new Window(this);
-    win->id = obj["id"].toInteger();
-    win->title = obj["title"].toString();
-    win->appId = obj["app_id"].toString();
+    WindowEntry entry;
+    static_cast<WindowData &>(entry) = data;
+    // Published without an icon if it's not cached yet, see onIconResolved()
+    entry.iconPath = IconResolver::instance()->lookup(data.appId);
+    return entry;
+}
 
-    QJsonValue pidValue = obj["pid"];
-    win->pid = pidValue.isNull() ? -1 : pidValue.toInt();
+QList<int> WindowModel::updateWindow(int row, const WindowData &data)
+{
+    WindowEntry &win = m_windows[row];
+    QList<int> roles;
 
-    QJsonValue workspaceIdValue = obj["workspace_id"];
-    win->workspaceId = workspaceIdValue.isNull() ? 0 : workspaceIdValue.toInteger();
+    auto update = [&roles](auto &field, const auto &value, int role) {
+        if (field != value) {
+            field = value;
+            roles.append(role);
+        }
+    };
+
+    update(win.title, data.title, TitleRole);
+    update(win.pid, data.pid, PidRole);
+    update(win.workspaceId, data.workspaceId, WorkspaceIdRole);
+    update(win.isFocused, data.isFocused, IsFocusedRole);
+    update(win.isFloating, data.isFloating, IsFloatingRole);
+    update(win.isUrgent, data.isUrgent, IsUrgentRole);
+    updateLayout(win.layout, data.layout, roles);
+
+    // The icon only depends on the app ID, so skip the lookup otherwise
+    if (win.appId != data.appId) {
+        win.appId = data.appId;
+        roles.append(AppIdRole);
+        update(win.iconPath, IconResolver::instance()->lookup(data.appId), IconPathRole);
+    }
 
-    win->isFocused = obj["is_focused"].toBool();
-    win->isFloating = obj["is_floating"].toBool();
-    win->isUrgent = obj["is_urgent"].toBool();
-    win->iconPath = IconLookup::lookup(win->appId);
+    notifyChanged(row, roles);
+    return roles;
+}
 
-    return win;
+void WindowModel::updateLayout(WindowLayout &current, const WindowLayout &layout, QList<int> &roles)
+{
+    auto update = [&roles](auto &field, const auto &value, int role) {
+        if (field != value) {
+            field = value;
+            roles.append(role);
+        }
+    };
+
+    update(current.tileSize, layout.tileSize, TileSizeRole);
+    update(current.windowSize, layout.windowSize, WindowSizeRole);
+    update(current.column, layout.column, ColumnRole);
+    update(current.tile, layout.tile, TileIndexRole);
+
+    if (current.hasTilePosition != layout.hasTilePosition ||
+        current.tilePosition != layout.tilePosition) {
+        current.tilePosition = layout.tilePosition;
+        current.hasTilePosition = layout.hasTilePosition;
+        roles.append(TilePositionRole);
+    }
 }
 
-int WindowModel::findWindowIndex(quint64 id) const
+void WindowModel::onIconResolved(const QString &appId, const QString &iconPath)
 {
     for (int i = 0; i < m_windows.count(); ++i) {
-        if (m_windows[i]->id == id)
-            return i;
+        WindowEntry &win = m_windows[i];
+        if (win.appId == appId && win.iconPath != iconPath) {
+            win.iconPath = iconPath;
+            notifyChanged(i, {IconPathRole});
+        }
+    }
+}
+
+int WindowModel::findWindowIndex(quint64 id) const
+{
+    return m_index.row(id);
+}
+
+void WindowModel::unfocusRow(int row)
+{
+    if (row == -1 || !m_windows[row].isFocused) {
+        return;
     }
-    return -1;
+
+    m_windows[row].isFocused = false;
+    notifyChanged(row, {IsFocusedRole});
 }
 
-void WindowModel::updateFocusedWindow()
+void WindowModel::notifyChanged(int row, const QList<int> &roles)
 {
-    Window *newFocused = nullptr;
+    if (roles.isEmpty()) {
+        return;
+    }
 
-    for (Window *win : m_windows) {
-        if (win->isFocused) {
-            newFocused = win;
+    if (m_pendingChanges.isEnabled()) {
+        m_pendingChanges.add(m_windows[row].id, roles);
+        return;
+    }
+
+    QModelIndex modelIdx = index(row);
+    emit dataChanged(modelIdx, modelIdx, roles);
+    notifyWindow(row, roles);
+}
+
+void WindowModel::notifyWindow(int row, const QList<int> &roles)
+{
+    const WindowEntry &entry = m_windows[row];
+    Window *win = m_windowObjects.value(entry.id);
+    if (!win) {
+        return;
+    }
+
+    // The object is read-only to QML, so it only changes here
+    win->m_entry = entry;
+
+    bool layoutChanged = false;
+    for (int role : roles) {
+        switch (role) {
+        case TitleRole:
+            emit win->titleChanged();
+            break;
+        case AppIdRole:
+            emit win->appIdChanged();
+            break;
+        case PidRole:
+            emit win->pidChanged();
+            break;
+        case WorkspaceIdRole:
+            emit win->workspaceIdChanged();
             break;
+        case IsFocusedRole:
+            emit win->isFocusedChanged();
+            break;
+        case IsFloatingRole:
+            emit win->isFloatingChanged();
+            break;
+        case IsUrgentRole:
+            emit win->isUrgentChanged();
+            break;
+        case IconPathRole:
+            emit win->iconPathChanged();
+            break;
+        case TileSizeRole:
+        case WindowSizeRole:
+        case ColumnRole:
+        case TileIndexRole:
+        case TilePositionRole:
+            layoutChanged = true;
+            break;
+        default:
+            break;
+        }
+    }
+
+    // One signal for all geometry properties
+    if (layoutChanged) {
+        emit win->layoutChanged();
+    }
+}
+
+Window* WindowModel::focusedWindow() const
+{
+    return m_focusedId ? window(m_focusedId) : nullptr;
+}
+
+Window* WindowModel::window(quint64 id) const
+{
+    if (Window *win = m_windowObjects.value(id)) {
+        return win;
+    }
+
+    int row = findWindowIndex(id);
+    if (row == -1) {
+        return nullptr;
+    }
+
+    Window *win = new Window(m_windows[row], const_cast<WindowModel *>(this));
+
+    // Owned by the model until the window closes, even when handed to QML
+    QQmlEngine::setObjectOwnership(win, QQmlEngine::CppOwnership);
+    m_windowObjects.insert(id, win);
+    return win;
+}
+
+void WindowModel::removeWindowObject(quint64 id)
+{
+    // Deferred, as QML may still be evaluating bindings that use it
+    if (Window *win = m_windowObjects.take(id)) {
+        win->deleteLater();
+    }
+}
+
+void WindowModel::setBatchInterval(int interval)
+{
+    if (batchInterval() == interval) {
+        return;
+    }
+
+    m_pendingChanges.setInterval(interval);
+    emit batchIntervalChanged();
+}
+
+void WindowModel::flushChanges()
+{
+    const QHash<quint64, QList<int>> changes = m_pendingChanges.take();
+
+    int first = -1;
+    int last = -1;
+    QList<int> roles;
+
+    for (auto it = changes.constBegin(); it != changes.constEnd(); ++it) {
+        int row = findWindowIndex(it.key());
+        if (row == -1) {
+            // Closed since it changed
+            continue;
         }
+
+        first = (first == -1) ? row : std::min(first, row);
+        last = std::max(last, row);
+        for (int role : it.value()) {
+            if (!roles.contains(role)) {
+                roles.append(role);
+            }
+        }
+        notifyWindow(row, it.value());
+    }
+
+    if (first != -1) {
+        emit dataChanged(index(first), index(last), roles);
+    }
+
+    if (m_focusedWindowChangePending) {
+        m_focusedWindowChangePending = false;
+        emit focusedWindowChanged();
     }
+}
 
+void WindowModel::setFocusedWindow(quint64 id)
+{
     // Emit if focus changed to a different window, or if the focused window's
     // properties changed.
-    bool shouldEmit = (m_focusedWindow != newFocused) || (newFocused != nullptr);
-    m_focusedWindow = newFocused;
+    bool shouldEmit = (m_focusedId != id) || (id != 0);
+    m_focusedId = id;
 
-    if (shouldEmit) {
+    if (shouldEmit && m_pendingChanges.isEnabled()) {
+        m_focusedWindowChangePending = true;
+        m_pendingChanges.schedule();
+    } else if (shouldEmit) {
         emit focusedWindowChanged();
     }
 }
+
+void WindowModel::setSortMode(SortMode mode)
+{
+    if (m_sortMode == mode) {
+        return;
+    }
+
+    m_sortMode = mode;
+    resort();
+    emit sortModeChanged();
+}
+
+void WindowModel::setWorkspaceModel(const WorkspaceModel *workspaces)
+{
+    if (m_workspaceModel) {
+        QObject::disconnect(m_workspaceModel, nullptr, this, nullptr);
+    }
+    m_workspaceModel = workspaces;
+    if (!workspaces) {
+        return;
+    }
+
+    // Windows only move when their workspace moves to another output or
+    // index. This isn't batched like dataChanged(), which could otherwise
+    // arrive after windows were placed by the new workspace positions.
+    QObject::connect(workspaces, &WorkspaceModel::positionsChanged,
+                     this, &WindowModel::scheduleResort);
+    resort();
+}
+
+bool WindowModel::lessThan(const WindowData &a, const WindowData &b) const
+{
+    // Windows on unknown workspaces go last, then floating windows within
+    // their workspace
+    auto key = [this](const WindowData &win) {
+        const Workspace *ws = m_workspaceModel ? m_workspaceModel->workspace(win.workspaceId) : nullptr;
+        return std::make_tuple(ws == nullptr,
+                               ws ? ws->output : QString(),
+                               ws ? int(ws->index) : INT_MAX,
+                               win.isFloating,
+                               win.layout.column,
+                               win.layout.tile,
+                               win.id);
+    };
+    return key(a) < key(b);
+}
+
+int WindowModel::insertionRow(const WindowData &data) const
+{
+    if (m_sortMode == NoSort) {
+        return m_windows.count();
+    }
+
+    auto it = std::upper_bound(m_windows.cbegin(), m_windows.cend(), data,
+                               [this](const WindowData &a, const WindowEntry &b) { return lessThan(a, b); });
+    return int(it - m_windows.cbegin());
+}
+
+void WindowModel::reposition(int row, const QList<int> &roles)
+{
+    // Other changes, e.g. of the title, focus or urgency, never reorder rows
+    bool positionChanged = roles.contains(WorkspaceIdRole) || roles.contains(IsFloatingRole) ||
+                           roles.contains(ColumnRole) || roles.contains(TileIndexRole);
+    if (m_sortMode == NoSort || !positionChanged) {
+        return;
+    }
+    if (m_resortPending) {
+        // The binary search below needs sorted rows, and this sorts the row too
+        resort();
+        return;
+    }
+
+    // All other rows are sorted, so the row is moved with a binary search
+    // among them
+
+    const WindowEntry &win = m_windows[row];
+    int target = row;
+    int destination = row;
+
+    if (row > 0 && lessThan(win, m_windows[row - 1])) {
+        auto it = std::upper_bound(m_windows.cbegin(), m_windows.cbegin() + row, win,
+                                   [this](const WindowData &a, const WindowEntry &b) { return lessThan(a, b); });
+        target = int(it - m_windows.cbegin());
+        destination = target;
+    } else if (row + 1 < m_windows.count() && lessThan(m_windows[row + 1], win)) {
+        auto it = std::lower_bound(m_windows.cbegin() + row + 1, m_windows.cend(), win,
+                                   [this](const WindowEntry &a, const WindowData &b) { return lessThan(a, b); });
+        destination = int(it - m_windows.cbegin());
+        target = destination - 1;
+    }
+
+    if (target == row) {
+        return;
+    }
+
+    beginMoveRows(QModelIndex(), row, row, QModelIndex(), destination);
+    m_windows.move(row, target);
+    m_index.move(row, target);
+    endMoveRows();
+}
+
+void WindowModel::scheduleResort()
+{
+    // One workspace snapshot can change many workspaces, so their changes
+    // are coalesced into a single resort. Until then, binary searches over
+    // the rows resort first.
+    if (m_sortMode == NoSort || m_resortPending) {
+        return;
+    }
+
+    m_resortPending = true;
+    QMetaObject::invokeMethod(this, &WindowModel::resort, Qt::QueuedConnection);
+}
+
+void WindowModel::resort()
+{
+    m_resortPending = false;
+    if (m_sortMode == NoSort) {
+        return;
+    }
+
+    QList<quint64> ids;
+    ids.reserve(m_windows.count());
+    for (const WindowEntry &win : std::as_const(m_windows)) {
+        ids.append(win.id);
+    }
+    std::stable_sort(ids.begin(), ids.end(), [this](quint64 a, quint64 b) {
+        return lessThan(m_windows[findWindowIndex(a)], m_windows[findWindowIndex(b)]);
+    });
+
+    // Rows before i are in place, so windows only ever move up
+    for (int i = 0; i < ids.count(); ++i) {
+        int row = findWindowIndex(ids[i]);
+        if (row == i) {
+            continue;
+        }
+
+        beginMoveRows(QModelIndex(), row, row, QModelIndex(), i);
+        m_windows.move(row, i);
+        m_index.move(row, i);
+        endMoveRows();
+    }
+}
@@ -1,45 +1,108 @@
 #pragma once
 
 #include <QAbstractListModel>
-#include <QJsonObject>
 #include <QObject>
+#include <QVariant>
+#include "events.h"
+#include "pendingchanges.h"
+#include "rowindex.h"
 
+class WorkspaceModel;
+
+/**
+ * Row of the window model: the window's data and its resolved icon.
+ */
+struct WindowEntry : WindowData {
+    QString iconPath;
+};
+
+/**
+ * A window, as exposed to QML. Its properties are read-only and follow the
+ * window's row in WindowModel.
+ */
 class Window : public QObject
 {
     Q_OBJECT
-    Q_PROPERTY(quint64 id MEMBER id CONSTANT)
-    Q_PROPERTY(QString title MEMBER title CONSTANT)
-    Q_PROPERTY(QString appId MEMBER appId CONSTANT)
-    Q_PROPERTY(qint32 pid MEMBER pid CONSTANT)
-    Q_PROPERTY(quint64 workspaceId MEMBER workspaceId CONSTANT)
-    Q_PROPERTY(bool isFocused MEMBER isFocused CONSTANT)
-    Q_PROPERTY(bool isFloating MEMBER isFloating CONSTANT)
-    Q_PROPERTY(bool isUrgent MEMBER isUrgent CONSTANT)
-    Q_PROPERTY(QString iconPath MEMBER iconPath CONSTANT)
+    Q_PROPERTY(quint64 id READ id CONSTANT)
+    Q_PROPERTY(QString title READ title NOTIFY titleChanged)
+    Q_PROPERTY(QString appId READ appId NOTIFY appIdChanged)
+    Q_PROPERTY(qint32 pid READ pid NOTIFY pidChanged)
+    Q_PROPERTY(quint64 workspaceId READ workspaceId NOTIFY workspaceIdChanged)
+    Q_PROPERTY(bool isFocused READ isFocused NOTIFY isFocusedChanged)
+    Q_PROPERTY(bool isFloating READ isFloating NOTIFY isFloatingChanged)
+    Q_PROPERTY(bool isUrgent READ isUrgent NOTIFY isUrgentChanged)
+    Q_PROPERTY(QString iconPath READ iconPath NOTIFY iconPathChanged)
+    Q_PROPERTY(QSizeF tileSize READ tileSize NOTIFY layoutChanged)
+    Q_PROPERTY(QSize windowSize READ windowSize NOTIFY layoutChanged)
+    Q_PROPERTY(int column READ column NOTIFY layoutChanged)
+    Q_PROPERTY(int tileIndex READ tileIndex NOTIFY layoutChanged)
+    Q_PROPERTY(QVariant tilePosition READ tilePosition NOTIFY layoutChanged)
 
 public:
-    explicit Window(QObject *parent = nullptr)
-        : QObject(parent), id(0), pid(-1), workspaceId(0),
-          isFocused(false), isFloating(false), isUrgent(false) {}
-
-    quint64 id;
-    QString title;
-    QString appId;
-    qint32 pid;
-    quint64 workspaceId;
-    bool isFocused;
-    bool isFloating;
-    bool isUrgent;
-    QString iconPath;
+    explicit Window(const WindowEntry &entry, QObject *parent = nullptr)
+        : QObject(parent), m_entry(entry) {}
+
+    quint64 id() const { return m_entry.id; }
+    QString title() const { return m_entry.title; }
+    QString appId() const { return m_entry.appId; }
+    qint32 pid() const { return m_entry.pid; }
+    quint64 workspaceId() const { return m_entry.workspaceId; }
+    bool isFocused() const { return m_entry.isFocused; }
+    bool isFloating() const { return m_entry.isFloating; }
+    bool isUrgent() const { return m_entry.isUrgent; }
+    QString iconPath() const { return m_entry.iconPath; }
+
+    QSizeF tileSize() const { return m_entry.layout.tileSize; }
+    QSize windowSize() const { return m_entry.layout.windowSize; }
+    int column() const { return m_entry.layout.column; }
+    int tileIndex() const { return m_entry.layout.tile; }
+    // Null unless the window is floating
+    QVariant tilePosition() const
+    {
+        return m_entry.layout.hasTilePosition ? QVariant(m_entry.layout.tilePosition) : QVariant();
+    }
+
+signals:
+    void titleChanged();
+    void appIdChanged();
+    void pidChanged();
+    void workspaceIdChanged();
+    void isFocusedChanged();
+    void isFloatingChanged();
+    void isUrgentChanged();
+    void iconPathChanged();
+    void layoutChanged();
+
+private:
+    // Only the model updates windows, before emitting their change signals
+    friend class WindowModel;
+    WindowEntry m_entry;
 };
 
+/**
+ * List model of all windows.
+ *
+ * Rows are stored by value. Window objects, such as focusedWindow, are only
+ * created when requested and are then kept in sync with their row until the
+ * window closes.
+ */
 class WindowModel : public QAbstractListModel
 {
     Q_OBJECT
     Q_PROPERTY(int count READ rowCount NOTIFY countChanged)
     Q_PROPERTY(Window* focusedWindow READ focusedWindow NOTIFY focusedWindowChanged)
+    Q_PROPERTY(int batchInterval READ batchInterval WRITE setBatchInterval NOTIFY batchIntervalChanged)
+    Q_PROPERTY(SortMode sortMode READ sortMode WRITE setSortMode NOTIFY sortModeChanged)
 
 public:
+    enum SortMode {
+        // niri's order for snapshots, new windows are appended
+        NoSort,
+        // Output name, workspace index, column, tile; floating windows last
+        PositionSort
+    };
+    Q_ENUM(SortMode)
+
     enum WindowRoles {
         IdRole = Qt::UserRole + 1,
         TitleRole,
@@ -49,7 +112,12 @@ public:
         IsFocusedRole,
         IsFloatingRole,
         IsUrgentRole,
-        IconPathRole
+        IconPathRole,
+        TileSizeRole,
+        WindowSizeRole,
+        ColumnRole,
+        TileIndexRole,
+        TilePositionRole
     };
 
     explicit WindowModel(QObject *parent = nullptr);
@@ -59,27 +127,81 @@ public:
     QVariant data(const QModelIndex &index, int role = Qt::DisplayRole) const override;
     QHash<int, QByteArray> roleNames() const override;
 
-    Window* focusedWindow() const { return m_focusedWindow; }
+    Window* focusedWindow() const;
+
+    // Object for the window with the given id, or null if there is none
+    Q_INVOKABLE Window* window(quint64 id) const;
+
+    /**
+     * Batch change notifications: -1 notifies every change immediately (the
+     * default), 0 merges changes until the next event loop turn, and a
+     * positive value merges them for that many milliseconds. Each flush emits
+     * a single dataChanged() covering all changed rows and roles.
+     */
+    int batchInterval() const { return m_pendingChanges.interval(); }
+    void setBatchInterval(int interval);
+
+    /**
+     * Keep rows sorted by position. Rows are inserted with a binary search
+     * and moved only when a change affects their position, so e.g. title
+     * changes never reorder. Switching back to NoSort keeps the current
+     * order. Sorting by position needs the workspace model.
+     */
+    SortMode sortMode() const { return m_sortMode; }
+    void setSortMode(SortMode mode);
+    void setWorkspaceModel(const WorkspaceModel *workspaces);
+
+    // Event types routed to handleEvent()
+    static QList<NiriEvent::Type> handledEvents();
 
 public slots:
-    void handleEvent(const QJsonObject &event);
+    void handleEvent(const NiriEvent &event);
 
 signals:
     void countChanged();
     void focusedWindowChanged();
+    void batchIntervalChanged();
+    void sortModeChanged();
 
 private:
-    void handleWindowsChanged(const QJsonArray &windows);
-    void handleWindowOpenedOrChanged(const QJsonObject &window);
+    void handleWindowsChanged(const QList<WindowData> &snapshot);
+    void handleWindowOpenedOrChanged(const WindowData &data);
     void handleWindowClosed(quint64 id);
-    void handleWindowFocusChanged(const QJsonValue &idValue);
+    void handleWindowFocusChanged(quint64 id);
     void handleWindowUrgencyChanged(quint64 id, bool urgent);
-    void handleWindowLayoutsChanged(const QJsonArray &changes);
+    void handleWindowLayoutsChanged(const Events::WindowLayoutsChanged &changes);
+
+    void onIconResolved(const QString &appId, const QString &iconPath);
 
-    Window* parseWindow(const QJsonObject &obj);
+    WindowEntry createEntry(const WindowData &data) const;
+    // Returns the roles that changed
+    QList<int> updateWindow(int row, const WindowData &data);
+    static void updateLayout(WindowLayout &current, const WindowLayout &layout, QList<int> &roles);
     int findWindowIndex(quint64 id) const;
-    void updateFocusedWindow();
+    void unfocusRow(int row);
+    void notifyChanged(int row, const QList<int> &roles);
+    void notifyWindow(int row, const QList<int> &roles);
+    void removeWindowObject(quint64 id);
+    void setFocusedWindow(quint64 id);
+    void flushChanges();
+
+    bool lessThan(const WindowData &a, const WindowData &b) const;
+    int insertionRow(const WindowData &data) const;
+    // Move a row whose sort key may have changed by the given roles
+    void reposition(int row, const QList<int> &roles);
+    void scheduleResort();
+    void resort();
+
+    QList<WindowEntry> m_windows;
+    RowIndex m_index;
+    // Id of the focused window, 0 if none
+    quint64 m_focusedId = 0;
+    // Window objects handed out so far, by id
+    mutable QHash<quint64, Window*> m_windowObjects;
+    PendingChanges m_pendingChanges;
+    bool m_focusedWindowChangePending = false;
 
-    QList<Window*> m_windows;
-    Window *m_focusedWindow = nullptr;
+    SortMode m_sortMode = NoSort;
+    bool m_resortPending = false;
+    const WorkspaceModel *m_workspaceModel = nullptr;
 };
@@ -1,10 +1,11 @@
 #include <algorithm>
 #include <QDebug>
-#include <QJsonArray>
+#include <QSet>
 #include "workspacemodel.h"
 
 WorkspaceModel::WorkspaceModel(QObject *parent)
     : QAbstractListModel(parent)
+    , m_pendingChanges([this] { flushChanges(); })
 {
 }
 
@@ -39,6 +40,8 @@ QVariant WorkspaceModel::data(const QModelIndex &index, int role) const
         return ws.isUrgent;
     case ActiveWindowIdRole:
         return QVariant::fromValue(ws.activeWindowId);
+    case OutputKeyRole:
+        return ws.outputKey;
     default:
         return QVariant();
     }
@@ -55,58 +58,131 @@ QHash<int, QByteArray> WorkspaceModel::roleNames() const
     roles[IsFocusedRole] = "isFocused";
     roles[IsUrgentRole] = "isUrgent";
     roles[ActiveWindowIdRole] = "activeWindowId";
+    roles[OutputKeyRole] = "outputKey";
     return roles;
 }
 
-void WorkspaceModel::handleEvent(const QJsonObject &event)
+QList<NiriEvent::Type> WorkspaceModel::handledEvents()
 {
-    if (event.contains("WorkspacesChanged")) {
-        QJsonArray workspaces = event["WorkspacesChanged"].toObject()["workspaces"].toArray();
-        handleWorkspacesChanged(workspaces);
+    return {
+        NiriEvent::WorkspacesChanged,
+        NiriEvent::WorkspaceActivated,
+        NiriEvent::WorkspaceUrgencyChanged,
+        NiriEvent::WorkspaceActiveWindowChanged,
+    };
+}
+
+void WorkspaceModel::handleEvent(const NiriEvent &event)
+{
+    switch (event.type) {
+    case NiriEvent::WorkspacesChanged:
+        handleWorkspacesChanged(event.get<Events::WorkspacesChanged>().workspaces);
+        break;
+    case NiriEvent::WorkspaceActivated: {
+        const auto &data = event.get<Events::WorkspaceActivated>();
+        handleWorkspaceActivated(data.id, data.focused);
+        break;
     }
-    else if (event.contains("WorkspaceActivated")) {
-        QJsonObject data = event["WorkspaceActivated"].toObject();
-        quint64 id = data["id"].toInteger();
-        bool focused = data["focused"].toBool();
-        handleWorkspaceActivated(id, focused);
+    case NiriEvent::WorkspaceUrgencyChanged: {
+        const auto &data = event.get<Events::WorkspaceUrgencyChanged>();
+        handleWorkspaceUrgencyChanged(data.id, data.urgent);
+        break;
     }
-    else if (event.contains("WorkspaceUrgencyChanged")) {
-        QJsonObject data = event["WorkspaceUrgencyChanged"].toObject();
-        quint64 id = data["id"].toInteger();
-        bool urgent = data["urgent"].toBool();
-        handleWorkspaceUrgencyChanged(id, urgent);
+    case NiriEvent::WorkspaceActiveWindowChanged: {
+        const auto &data = event.get<Events::WorkspaceActiveWindowChanged>();
+        handleWorkspaceActiveWindowChanged(data.workspaceId, data.activeWindowId);
+        break;
     }
-    else if (event.contains("WorkspaceActiveWindowChanged")) {
-        QJsonObject data = event["WorkspaceActiveWindowChanged"].toObject();
-        quint64 workspaceId = data["workspace_id"].toInteger();
-        QJsonValue activeWindowId = data["active_window_id"];
-        handleWorkspaceActiveWindowChanged(workspaceId, activeWindowId);
+    default:
+        break;
     }
 }
 
-void WorkspaceModel::handleWorkspacesChanged(const QJsonArray &workspaces)
+void WorkspaceModel::handleWorkspacesChanged(QList<Workspace> workspaces)
 {
-    beginResetModel();
-    m_workspaces.clear();
-
-    for (const QJsonValue &value : workspaces) {
-        if (value.isObject()) {
-            m_workspaces.append(parseWorkspace(value.toObject()));
-        }
-    }
-
     // Sort by index (which corresponds to workspace position on its output)
-    std::sort(m_workspaces.begin(), m_workspaces.end(),
+    std::sort(workspaces.begin(), workspaces.end(),
               [](const Workspace &a, const Workspace &b) {
                   // First sort by output name, then by index within output
-                  if (a.output != b.output) {
+                  if (a.outputKey != b.outputKey) {
                       return a.output < b.output;
                   }
                   return a.index < b.index;
               });
 
-    endResetModel();
-    emit countChanged();
+    // Reconcile with the snapshot by id instead of resetting the model, so
+    // delegates of workspaces that are still around survive it.
+    int oldCount = m_workspaces.count();
+    bool moved = false;
+
+    QSet<quint64> ids;
+    ids.reserve(workspaces.count());
+    for (const Workspace &ws : workspaces) {
+        ids.insert(ws.id);
+    }
+
+    // Remove workspaces missing from the snapshot, in contiguous ranges from the end
+    for (int last = m_workspaces.count() - 1; last >= 0; --last) {
+        if (ids.contains(m_workspaces[last].id)) {
+            continue;
+        }
+
+        int first = last;
+        while (first > 0 && !ids.contains(m_workspaces[first - 1].id)) {
+            --first;
+        }
+
+        beginRemoveRows(QModelIndex(), first, last);
+        for (int row = last; row >= first; --row) {
+            m_workspaces.removeAt(row);
+            m_index.remove(row);
+        }
+        endRemoveRows();
+        moved = true;
+
+        last = first;
+    }
+
+    // Insert, move and update the remaining rows to match the sorted snapshot.
+    // Rows before i are already in place, so an existing workspace is always
+    // moved up.
+    int i = 0;
+    for (const Workspace &ws : std::as_const(workspaces)) {
+        int row = findWorkspaceIndex(ws.id);
+
+        if (row != -1 && row < i) {
+            qWarning() << "Duplicate workspace in snapshot:" << ws.id;
+            continue;
+        }
+
+        if (row == -1) {
+            beginInsertRows(QModelIndex(), i, i);
+            m_workspaces.insert(i, ws);
+            m_index.insert(i, ws.id);
+            endInsertRows();
+            moved = true;
+        } else {
+            if (row != i) {
+                beginMoveRows(QModelIndex(), row, row, QModelIndex(), i);
+                m_workspaces.move(row, i);
+                m_index.move(row, i);
+                endMoveRows();
+            }
+            const Workspace &current = m_workspaces[i];
+            moved = moved || current.index != ws.index || current.outputKey != ws.outputKey;
+            updateWorkspace(i, ws);
+        }
+        ++i;
+    }
+
+    updateTracking();
+
+    if (m_workspaces.count() != oldCount) {
+        emit countChanged();
+    }
+    if (moved) {
+        emit positionsChanged();
+    }
 }
 
 void WorkspaceModel::handleWorkspaceActivated(quint64 id, bool focused)
@@ -117,28 +193,22 @@ void WorkspaceModel::handleWorkspaceActivated(quint64 id, bool focused)
         return;
     }
 
-    const QString &output = m_workspaces[idx].output;
-
-    // Update all workspaces on the same output
-    for (int i = 0; i < m_workspaces.count(); ++i) {
-        if (m_workspaces[i].output == output) {
-            bool becameActive = (i == idx);
-            if (m_workspaces[i].isActive != becameActive) {
-                m_workspaces[i].isActive = becameActive;
-                QModelIndex modelIdx = index(i);
-                emit dataChanged(modelIdx, modelIdx, {IsActiveRole});
-            }
-        }
+    // Only the previously active workspace on the same output changes
+    quint64 &activeId = m_activeWorkspaceIds[m_workspaces[idx].outputKey];
+    if (activeId != id) {
+        setRowFlag(findWorkspaceIndex(activeId), &Workspace::isActive, false, IsActiveRole);
+        activeId = id;
+    }
+    setRowFlag(idx, &Workspace::isActive, true, IsActiveRole);
 
-        // If focused, update all workspaces' focus state
-        if (focused) {
-            bool becameFocused = (i == idx);
-            if (m_workspaces[i].isFocused != becameFocused) {
-                m_workspaces[i].isFocused = becameFocused;
-                QModelIndex modelIdx = index(i);
-                emit dataChanged(modelIdx, modelIdx, {IsFocusedRole});
-            }
+    // If focused, only the previously focused workspace changes
+    if (focused) {
+        if (m_focusedWorkspaceId != id) {
+            setRowFlag(findWorkspaceIndex(m_focusedWorkspaceId), &Workspace::isFocused,
+                       false, IsFocusedRole);
+            m_focusedWorkspaceId = id;
         }
+        setRowFlag(idx, &Workspace::isFocused, true, IsFocusedRole);
     }
 }
 
@@ -152,12 +222,11 @@ void WorkspaceModel::handleWorkspaceUrgencyChanged(quint64 id, bool urgent)
 
     if (m_workspaces[idx].isUrgent != urgent) {
         m_workspaces[idx].isUrgent = urgent;
-        QModelIndex modelIdx = index(idx);
-        emit dataChanged(modelIdx, modelIdx, {IsUrgentRole});
+        notifyChanged(idx, {IsUrgentRole});
     }
 }
 
-void WorkspaceModel::handleWorkspaceActiveWindowChanged(quint64 workspaceId, const QJsonValue &activeWindowId)
+void WorkspaceModel::handleWorkspaceActiveWindowChanged(quint64 workspaceId, quint64 activeWindowId)
 {
     int idx = findWorkspaceIndex(workspaceId);
     if (idx == -1) {
@@ -165,36 +234,141 @@ void WorkspaceModel::handleWorkspaceActiveWindowChanged(quint64 workspaceId, con
         return;
     }
 
-    quint64 newActiveWindowId = activeWindowId.isNull() ? 0 : activeWindowId.toInteger();
-    if (m_workspaces[idx].activeWindowId != newActiveWindowId) {
-        m_workspaces[idx].activeWindowId = newActiveWindowId;
-        QModelIndex modelIdx = index(idx);
-        emit dataChanged(modelIdx, modelIdx, {ActiveWindowIdRole});
+    if (m_workspaces[idx].activeWindowId != activeWindowId) {
+        m_workspaces[idx].activeWindowId = activeWindowId;
+        notifyChanged(idx, {ActiveWindowIdRole});
     }
 }
 
-Workspace WorkspaceModel::parseWorkspace(const QJsonObject &obj)
+int WorkspaceModel::findWorkspaceIndex(quint64 id) const
+{
+    return m_index.row(id);
+}
+
+void WorkspaceModel::updateWorkspace(int row, const Workspace &ws)
 {
-    Workspace ws;
-    ws.id = obj["id"].toInteger();
-    ws.index = obj["idx"].toInt();
-    ws.name = obj["name"].toString();
-    ws.output = obj["output"].toString();
-    ws.isActive = obj["is_active"].toBool();
-    ws.isFocused = obj["is_focused"].toBool();
-    ws.isUrgent = obj["is_urgent"].toBool();
+    Workspace &current = m_workspaces[row];
+    QList<int> roles;
 
-    QJsonValue activeWindowId = obj["active_window_id"];
-    ws.activeWindowId = activeWindowId.isNull() ? 0 : activeWindowId.toInteger();
+    auto update = [&roles](auto &field, const auto &value, int role) {
+        if (field != value) {
+            field = value;
+            roles.append(role);
+        }
+    };
 
-    return ws;
+    update(current.index, ws.index, IndexRole);
+    update(current.name, ws.name, NameRole);
+    if (current.outputKey != ws.outputKey) {
+        current.output = ws.output;
+        current.outputKey = ws.outputKey;
+        roles.append(OutputRole);
+        roles.append(OutputKeyRole);
+    }
+    update(current.isActive, ws.isActive, IsActiveRole);
+    update(current.isFocused, ws.isFocused, IsFocusedRole);
+    update(current.isUrgent, ws.isUrgent, IsUrgentRole);
+    update(current.activeWindowId, ws.activeWindowId, ActiveWindowIdRole);
+
+    notifyChanged(row, roles);
 }
 
-int WorkspaceModel::findWorkspaceIndex(quint64 id) const
+const Workspace *WorkspaceModel::workspace(quint64 id) const
+{
+    int row = findWorkspaceIndex(id);
+    return row == -1 ? nullptr : &m_workspaces[row];
+}
+
+int WorkspaceModel::focusedOutputKey() const
+{
+    int row = findWorkspaceIndex(m_focusedWorkspaceId);
+    return row == -1 ? 0 : m_workspaces[row].outputKey;
+}
+
+QSet<int> WorkspaceModel::outputKeys() const
+{
+    QSet<int> keys;
+    for (auto it = m_activeWorkspaceIds.constBegin(); it != m_activeWorkspaceIds.constEnd(); ++it) {
+        keys.insert(it.key());
+    }
+    return keys;
+}
+
+void WorkspaceModel::updateTracking()
+{
+    m_activeWorkspaceIds.clear();
+    m_focusedWorkspaceId = 0;
+
+    for (const Workspace &ws : std::as_const(m_workspaces)) {
+        if (ws.isActive) {
+            m_activeWorkspaceIds.insert(ws.outputKey, ws.id);
+        }
+        if (ws.isFocused) {
+            m_focusedWorkspaceId = ws.id;
+        }
+    }
+}
+
+void WorkspaceModel::setRowFlag(int row, bool Workspace::*flag, bool value, int role)
+{
+    if (row == -1 || m_workspaces[row].*flag == value) {
+        return;
+    }
+
+    m_workspaces[row].*flag = value;
+    notifyChanged(row, {role});
+}
+
+void WorkspaceModel::notifyChanged(int row, const QList<int> &roles)
+{
+    if (roles.isEmpty()) {
+        return;
+    }
+
+    if (m_pendingChanges.isEnabled()) {
+        m_pendingChanges.add(m_workspaces[row].id, roles);
+        return;
+    }
+
+    QModelIndex modelIdx = index(row);
+    emit dataChanged(modelIdx, modelIdx, roles);
+}
+
+void WorkspaceModel::setBatchInterval(int interval)
+{
+    if (batchInterval() == interval) {
+        return;
+    }
+
+    m_pendingChanges.setInterval(interval);
+    emit batchIntervalChanged();
+}
+
+void WorkspaceModel::flushChanges()
 {
-    for (int i = 0; i < m_workspaces.count(); ++i) {
-        if (m_workspaces[i].id == id)
-            return i;
+    const QHash<quint64, QList<int>> changes = m_pendingChanges.take();
+
+    int first = -1;
+    int last = -1;
+    QList<int> roles;
+
+    for (auto it = changes.constBegin(); it != changes.constEnd(); ++it) {
+        int row = findWorkspaceIndex(it.key());
+        if (row == -1) {
+            // Removed since it changed
+            continue;
+        }
+
+        first = (first == -1) ? row : std::min(first, row);
+        last = std::max(last, row);
+        for (int role : it.value()) {
+            if (!roles.contains(role)) {
+                roles.append(role);
+            }
+        }
+    }
+
+    if (first != -1) {
+        emit dataChanged(index(first), index(last), roles);
     }
-    return -1;
 }
@@ -1,23 +1,16 @@
 #pragma once
 
 #include <QAbstractListModel>
-#include <QJsonObject>
-
-struct Workspace {
-    quint64 id;
-    quint8 index;
-    QString name;
-    QString output;
-    bool isActive;
-    bool isFocused;
-    bool isUrgent;
-    quint64 activeWindowId;
-};
+#include <QSet>
+#include "events.h"
+#include "pendingchanges.h"
+#include "rowindex.h"
 
 class WorkspaceModel : public QAbstractListModel
 {
     Q_OBJECT
     Q_PROPERTY(int count READ rowCount NOTIFY countChanged)
+    Q_PROPERTY(int batchInterval READ batchInterval WRITE setBatchInterval NOTIFY batchIntervalChanged)
 
 public:
     enum WorkspaceRoles {
@@ -28,7 +21,8 @@ public:
         IsActiveRole,
         IsFocusedRole,
         IsUrgentRole,
-        ActiveWindowIdRole
+        ActiveWindowIdRole,
+        OutputKeyRole
     };
 
     explicit WorkspaceModel(QObject *parent = nullptr);
@@ -37,20 +31,52 @@ public:
     QVariant data(const QModelIndex &index, int role = Qt::DisplayRole) const override;
     QHash<int, QByteArray> roleNames() const override;
 
+    bool contains(quint64 id) const { return m_index.contains(id); }
+    // The workspace with the given id, or null
+    const Workspace *workspace(quint64 id) const;
+
+    // Output key of the focused workspace, 0 if none
+    int focusedOutputKey() const;
+    // Keys of the outputs with an active workspace, i.e. all outputs in use
+    QSet<int> outputKeys() const;
+
+    // Change notification batching, see WindowModel::batchInterval()
+    int batchInterval() const { return m_pendingChanges.interval(); }
+    void setBatchInterval(int interval);
+
+    // Event types routed to handleEvent()
+    static QList<NiriEvent::Type> handledEvents();
+
 public slots:
-    void handleEvent(const QJsonObject &event);
+    void handleEvent(const NiriEvent &event);
 
 signals:
     void countChanged();
+    void batchIntervalChanged();
+    /**
+     * Workspaces were added or removed, or changed index or output. Emitted
+     * once per snapshot and right away, even when change notifications are
+     * batched.
+     */
+    void positionsChanged();
 
 private:
-    void handleWorkspacesChanged(const QJsonArray &workspaces);
+    void handleWorkspacesChanged(QList<Workspace> workspaces);
     void handleWorkspaceActivated(quint64 id, bool focused);
     void handleWorkspaceUrgencyChanged(quint64 id, bool urgent);
-    void handleWorkspaceActiveWindowChanged(quint64 workspaceId, const QJsonValue &activeWindowId);
+    void handleWorkspaceActiveWindowChanged(quint64 workspaceId, quint64 activeWindowId);
 
-    Workspace parseWorkspace(const QJsonObject &obj);
     int findWorkspaceIndex(quint64 id) const;
+    void updateWorkspace(int row, const Workspace &ws);
+    void updateTracking();
+    void setRowFlag(int row, bool Workspace::*flag, bool value, int role);
+    void notifyChanged(int row, const QList<int> &roles);
+    void flushChanges();
 
     QList<Workspace> m_workspaces;
+    RowIndex m_index;
+    // Active workspace per output key, and the focused workspace (0 if none)
+    QHash<int, quint64> m_activeWorkspaceIds;
+    quint64 m_focusedWorkspaceId = 0;
+    PendingChanges m_pendingChanges;
 };
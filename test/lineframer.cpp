@@ -0,0 +1,72 @@
+#include <functional>
+#include <QTest>
+#include "lineframer.h"
+
+// Lines are views into the framer's buffer
+static QByteArray copy(const QByteArray &line)
+{
+    return QByteArray(line.constData(), line.size());
+}
+
+class LineFramerTest : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void splitsLines()
+    {
+        LineFramer framer;
+        QList<QByteArray> lines;
+        auto collect = [&lines](const QByteArray &line) { lines.append(copy(line)); };
+
+        framer.append("one\ntw", collect);
+        QCOMPARE(lines, QList<QByteArray>({"one"}));
+        QCOMPARE(framer.pendingSize(), qsizetype(2));
+
+        framer.append("o\n\nthree\n", collect);
+        QCOMPARE(lines, QList<QByteArray>({"one", "two", "", "three"}));
+        QCOMPARE(framer.pendingSize(), qsizetype(0));
+    }
+
+    void clearFromCallback()
+    {
+        // E.g. the connection is reset while an event is handled
+        LineFramer framer;
+        QList<QByteArray> lines;
+        framer.append("one\ntwo\nthree\npartial", [&](const QByteArray &line) {
+            lines.append(copy(line));
+            if (line == "two") {
+                framer.clear();
+            }
+        });
+        QCOMPARE(lines, QList<QByteArray>({"one", "two"}));
+        QCOMPARE(framer.pendingSize(), qsizetype(0));
+
+        // The dropped lines don't come back
+        lines.clear();
+        framer.append("four\n", [&lines](const QByteArray &line) { lines.append(copy(line)); });
+        QCOMPARE(lines, QList<QByteArray>({"four"}));
+    }
+
+    void appendFromCallback()
+    {
+        // The lines of the outer call stay valid while the buffer changes
+        LineFramer framer;
+        QList<QByteArray> lines;
+        bool nested = false;
+        std::function<void(const QByteArray &)> collect = [&](const QByteArray &line) {
+            lines.append(copy(line));
+            if (!nested) {
+                nested = true;
+                framer.clear();
+                framer.append("inner\n", collect);
+            }
+        };
+        framer.append("outer\nskipped\n", collect);
+        QCOMPARE(lines, QList<QByteArray>({"outer", "inner"}));
+        QCOMPARE(framer.pendingSize(), qsizetype(0));
+    }
+};
+
+QTEST_APPLESS_MAIN(LineFramerTest)
+#include "lineframer.moc"
@@ -0,0 +1,285 @@
+#include <QAbstractItemModelTester>
+#include <QSignalSpy>
+#include <QTest>
+#include "events.h"
+#include "filtermodel.h"
+#include "rowindex.h"
+#include "stringpool.h"
+#include "windowmodel.h"
+#include "workspacemodel.h"
+
+// Row mappings of the sorted window model, FilterModel and RowIndex. The
+// models are driven with decoded events, as the IPC client would.
+
+template<typename T>
+static NiriEvent makeEvent(NiriEvent::Type type, T payload)
+{
+    NiriEvent event;
+    event.type = type;
+    event.payload = std::move(payload);
+    return event;
+}
+
+static Workspace makeWorkspace(quint64 id, quint8 index, const QString &output)
+{
+    Workspace ws{};
+    ws.id = id;
+    ws.index = index;
+    ws.output = StringPool::intern(output, &ws.outputKey);
+    return ws;
+}
+
+static WindowData makeWindow(quint64 id, quint64 workspaceId, int column, bool floating = false)
+{
+    WindowData win;
+    win.id = id;
+    win.title = QStringLiteral("Window %1").arg(id);
+    win.appId = QStringLiteral("org.example.Test");
+    win.workspaceId = workspaceId;
+    win.isFloating = floating;
+    if (!floating) {
+        win.layout.column = column;
+        win.layout.tile = 1;
+    }
+    return win;
+}
+
+static void openWindow(WindowModel &model, const WindowData &win)
+{
+    model.handleEvent(makeEvent(NiriEvent::WindowOpenedOrChanged, Events::WindowOpenedOrChanged{win}));
+}
+
+static void closeWindow(WindowModel &model, quint64 id)
+{
+    model.handleEvent(makeEvent(NiriEvent::WindowClosed, Events::WindowClosed{id}));
+}
+
+static QList<quint64> ids(const QAbstractItemModel &model)
+{
+    QList<quint64> result;
+    for (int row = 0; row < model.rowCount(); ++row) {
+        result.append(model.data(model.index(row, 0), WindowModel::IdRole).toULongLong());
+    }
+    return result;
+}
+
+class ModelsTest : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void init()
+    {
+        m_workspaces = new WorkspaceModel(this);
+        m_workspaces->handleEvent(makeEvent(NiriEvent::WorkspacesChanged, Events::WorkspacesChanged{{
+            makeWorkspace(1, 1, "DP-1"),
+            makeWorkspace(2, 2, "DP-1"),
+            makeWorkspace(3, 1, "HDMI-A-1"),
+        }}));
+
+        m_windows = new WindowModel(this);
+        new QAbstractItemModelTester(m_windows, QAbstractItemModelTester::FailureReportingMode::QtTest,
+                                     m_windows);
+    }
+
+    void cleanup()
+    {
+        delete m_windows;
+        delete m_workspaces;
+    }
+
+    void sortedInsert()
+    {
+        m_windows->setSortMode(WindowModel::PositionSort);
+        m_windows->setWorkspaceModel(m_workspaces);
+        QSignalSpy inserted(m_windows, &QAbstractItemModel::rowsInserted);
+
+        openWindow(*m_windows, makeWindow(10, 2, 1));
+        openWindow(*m_windows, makeWindow(11, 1, 2));
+        openWindow(*m_windows, makeWindow(12, 1, 1));
+        openWindow(*m_windows, makeWindow(13, 3, 1));
+        openWindow(*m_windows, makeWindow(14, 1, 0, true));
+        // Unknown workspaces go last
+        openWindow(*m_windows, makeWindow(15, 9, 1));
+
+        QCOMPARE(ids(*m_windows), QList<quint64>({12, 11, 14, 10, 13, 15}));
+        QCOMPARE(inserted.count(), 6);
+        // Each window was inserted at its final row at the time
+        QList<int> rows;
+        for (const QList<QVariant> &args : std::as_const(inserted)) {
+            rows.append(args.at(1).toInt());
+        }
+        QCOMPARE(rows, QList<int>({0, 0, 0, 3, 2, 5}));
+    }
+
+    void sortedMove()
+    {
+        m_windows->setSortMode(WindowModel::PositionSort);
+        m_windows->setWorkspaceModel(m_workspaces);
+        for (quint64 id : {10, 11, 12}) {
+            openWindow(*m_windows, makeWindow(id, 1, int(id) - 9));
+        }
+        openWindow(*m_windows, makeWindow(13, 3, 1));
+        QCOMPARE(ids(*m_windows), QList<quint64>({10, 11, 12, 13}));
+        QSignalSpy moved(m_windows, &QAbstractItemModel::rowsMoved);
+
+        // Titles don't affect the order
+        WindowData win = makeWindow(10, 1, 1);
+        win.title = QStringLiteral("Renamed");
+        openWindow(*m_windows, win);
+        QCOMPARE(moved.count(), 0);
+
+        Events::WindowLayoutsChanged layouts;
+        WindowLayout layout;
+        layout.column = 4;
+        layout.tile = 1;
+        layouts.changes.append({10, layout});
+        m_windows->handleEvent(makeEvent(NiriEvent::WindowLayoutsChanged, layouts));
+        QCOMPARE(ids(*m_windows), QList<quint64>({11, 12, 10, 13}));
+        QCOMPARE(moved.count(), 1);
+
+        // To another output
+        openWindow(*m_windows, makeWindow(11, 3, 2));
+        QCOMPARE(ids(*m_windows), QList<quint64>({12, 10, 13, 11}));
+        QCOMPARE(moved.count(), 2);
+
+        // Back to the front
+        openWindow(*m_windows, makeWindow(11, 1, 0));
+        QCOMPARE(ids(*m_windows), QList<quint64>({11, 12, 10, 13}));
+        QCOMPARE(moved.count(), 3);
+    }
+
+    void sortedRemove()
+    {
+        m_windows->setSortMode(WindowModel::PositionSort);
+        m_windows->setWorkspaceModel(m_workspaces);
+        for (quint64 id : {10, 11, 12, 13}) {
+            openWindow(*m_windows, makeWindow(id, 1, int(id) - 9));
+        }
+
+        closeWindow(*m_windows, 11);
+        closeWindow(*m_windows, 13);
+        QCOMPARE(ids(*m_windows), QList<quint64>({10, 12}));
+
+        // Rows after a removed one are still found by id
+        openWindow(*m_windows, makeWindow(12, 1, 0));
+        QCOMPARE(ids(*m_windows), QList<quint64>({12, 10}));
+        QCOMPARE(m_windows->window(10)->column(), 1);
+    }
+
+    void sortedWorkspaceMove()
+    {
+        m_windows->setSortMode(WindowModel::PositionSort);
+        m_windows->setWorkspaceModel(m_workspaces);
+        openWindow(*m_windows, makeWindow(10, 1, 1));
+        openWindow(*m_windows, makeWindow(11, 2, 1));
+        openWindow(*m_windows, makeWindow(12, 3, 1));
+
+        // Workspace 1 moves behind workspace 3 on the other output
+        m_workspaces->handleEvent(makeEvent(NiriEvent::WorkspacesChanged, Events::WorkspacesChanged{{
+            makeWorkspace(1, 2, "HDMI-A-1"),
+            makeWorkspace(2, 1, "DP-1"),
+            makeWorkspace(3, 1, "HDMI-A-1"),
+        }}));
+        // The resort is queued, but new windows are placed after it
+        openWindow(*m_windows, makeWindow(13, 2, 2));
+        QCOMPARE(ids(*m_windows), QList<quint64>({11, 13, 12, 10}));
+    }
+
+    void filterInsertRemove()
+    {
+        FilterModel filter(m_windows, WindowModel::WorkspaceIdRole, QVariant::fromValue(quint64(1)));
+        QAbstractItemModelTester tester(&filter, QAbstractItemModelTester::FailureReportingMode::QtTest);
+
+        for (quint64 id : {10, 11, 12, 13, 14}) {
+            openWindow(*m_windows, makeWindow(id, id % 2 ? 2 : 1, 1));
+        }
+        QCOMPARE(ids(filter), QList<quint64>({10, 12, 14}));
+
+        // Removing rows outside the filter shifts the mapped ones
+        QSignalSpy removed(&filter, &QAbstractItemModel::rowsRemoved);
+        closeWindow(*m_windows, 11);
+        QCOMPARE(removed.count(), 0);
+        QCOMPARE(ids(filter), QList<quint64>({10, 12, 14}));
+
+        closeWindow(*m_windows, 12);
+        QCOMPARE(removed.count(), 1);
+        QCOMPARE(ids(filter), QList<quint64>({10, 14}));
+
+        // Changing the filter role inserts and removes rows
+        openWindow(*m_windows, makeWindow(13, 1, 1));
+        QCOMPARE(ids(filter), QList<quint64>({10, 13, 14}));
+        openWindow(*m_windows, makeWindow(10, 2, 1));
+        QCOMPARE(ids(filter), QList<quint64>({13, 14}));
+        QCOMPARE(filter.data(filter.index(0), WindowModel::TitleRole).toString(),
+                 QStringLiteral("Window 13"));
+    }
+
+    void filterMove()
+    {
+        m_windows->setSortMode(WindowModel::PositionSort);
+        m_windows->setWorkspaceModel(m_workspaces);
+        FilterModel filter(m_windows, WindowModel::WorkspaceIdRole, QVariant::fromValue(quint64(1)));
+        QAbstractItemModelTester tester(&filter, QAbstractItemModelTester::FailureReportingMode::QtTest);
+
+        openWindow(*m_windows, makeWindow(10, 1, 1));
+        openWindow(*m_windows, makeWindow(11, 2, 1));
+        openWindow(*m_windows, makeWindow(12, 1, 2));
+        openWindow(*m_windows, makeWindow(13, 1, 3));
+        QCOMPARE(ids(*m_windows), QList<quint64>({10, 12, 13, 11}));
+        QCOMPARE(ids(filter), QList<quint64>({10, 12, 13}));
+
+        // Moves within the filter
+        openWindow(*m_windows, makeWindow(10, 1, 4));
+        QCOMPARE(ids(filter), QList<quint64>({12, 13, 10}));
+
+        // Moves out of it, across a row outside the filter
+        openWindow(*m_windows, makeWindow(12, 2, 2));
+        QCOMPARE(ids(*m_windows), QList<quint64>({13, 10, 11, 12}));
+        QCOMPARE(ids(filter), QList<quint64>({13, 10}));
+    }
+
+    void filterSourceDestroyed()
+    {
+        FilterModel filter(m_windows, WindowModel::WorkspaceIdRole, QVariant::fromValue(quint64(1)));
+        openWindow(*m_windows, makeWindow(10, 1, 1));
+        QCOMPARE(filter.rowCount(), 1);
+
+        delete m_windows;
+        m_windows = nullptr;
+        QCOMPARE(filter.rowCount(), 0);
+    }
+
+    void rowIndexRenumbering()
+    {
+        RowIndex index;
+        index.reset({10, 11, 12});
+        index.insert(1, 13);
+        QCOMPARE(index.row(10), 0);
+        QCOMPARE(index.row(13), 1);
+        QCOMPARE(index.row(12), 3);
+
+        index.remove(0);
+        QCOMPARE(index.row(10), -1);
+        QCOMPARE(index.row(13), 0);
+        QCOMPARE(index.row(12), 2);
+
+        index.move(0, 2);
+        QCOMPARE(index.id(2), quint64(13));
+        QCOMPARE(index.row(11), 0);
+        QCOMPARE(index.row(12), 1);
+        QCOMPARE(index.row(13), 2);
+
+        index.move(2, 0);
+        QCOMPARE(index.row(13), 0);
+        QCOMPARE(index.row(12), 2);
+        QCOMPARE(index.count(), 3);
+    }
+
+private:
+    WorkspaceModel *m_workspaces = nullptr;
+    WindowModel *m_windows = nullptr;
+};
+
+QTEST_MAIN(ModelsTest)
+#include "models.moc"